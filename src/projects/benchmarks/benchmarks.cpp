@@ -0,0 +1,273 @@
+#include "read_simulator.hpp"
+#include "dbg/dbg_construction.hpp"
+#include "dbg/graph_algorithms.hpp"
+#include "dbg/graph_alignment_storage.hpp"
+#include "polishing/perfect_alignment.hpp"
+#include "polishing/homopolish.hpp"
+#include "sequences/seqio.hpp"
+#include "common/cl_parser.hpp"
+#include "common/logging.hpp"
+#include "common/stage_profiler.hpp"
+#include <fstream>
+#include <iomanip>
+#include <malloc.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace dbg;
+
+struct BenchmarkResult {
+    std::string name;
+    size_t threads;
+    double wall_sec;
+    size_t bases;
+    double peak_rss_mb;
+};
+
+//Runs f in a separate stage timer and records its time and peak memory. Throughput is computed from the size of the
+//benchmark input and not from the amount of data processed inside so that it does not depend on the implementation.
+template<class F>
+void measure(logging::Logger &logger, const std::string &name, size_t threads, size_t input_bases,
+             std::vector<BenchmarkResult> &results, F f) {
+    logger.info() << "Running benchmark " << name << " with " << threads << " threads" << std::endl;
+    VertexLock::ResetStats();
+    logging::StageTimer timer(name + " threads=" + itos(threads));
+    f();
+    timer.finish();
+    LockStats lock_stats = VertexLock::Stats();
+    logger.trace() << "Vertex locks: " << lock_stats.contended << " contended acquisitions, " << lock_stats.spins
+                   << " wait iterations" << std::endl;
+    results.push_back({name, threads, timer.wallSec(), input_bases, timer.peakRssMb()});
+}
+
+//Resident memory of the process in Mb. Free heap memory is returned to the system first so that released buffers are
+//not counted.
+double currentRssMb() {
+    malloc_trim(0);
+    std::ifstream is("/proc/self/status");
+    std::string line;
+    while(std::getline(is, line)) {
+        if(line.compare(0, 6, "VmRSS:") == 0)
+            return double(std::stoull(line.substr(6))) / 1024;
+    }
+    return 0;
+}
+
+//Heap memory in use in Mb. Unlike RSS it does not count freed memory that the allocator keeps for reuse.
+double currentHeapMb() {
+    struct mallinfo2 info = mallinfo2();
+    return double(info.uordblks + info.hblkhd) / 1024 / 1024;
+}
+
+//Same as the first part of constructDBG: graph with filled edges and bound tips before merging of unbranching paths
+SparseDBG constructUnmergedDBG(logging::Logger &logger, const std::vector<hashing::htype> &vertices,
+                               const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher,
+                               size_t threads) {
+    SparseDBG dbg(vertices.begin(), vertices.end(), hasher);
+    std::function<void(size_t, Sequence &)> edge_filling_task = [&dbg](size_t pos, Sequence & seq) {
+        dbg.processRead(seq);
+    };
+    processRecords(disjointigs.begin(), disjointigs.end(), logger, threads, edge_filling_task);
+    std::vector<std::pair<Vertex *, Edge *>> tips;
+    for(Vertex &vertex : dbg.vertices()) {
+        for(Edge &edge : vertex) {
+            if(edge.end() == nullptr)
+                tips.emplace_back(&vertex, &edge);
+        }
+    }
+    for(std::pair<Vertex *, Edge *> &tip : tips) {
+        dbg.bindTip(*tip.first, *tip.second);
+    }
+    return std::move(dbg);
+}
+
+std::string constructMessage() {
+    std::stringstream ss;
+    ss << "Benchmarks of LJA hot paths on deterministic simulated HiFi reads.\n";
+    ss << "Usage: lja_benchmarks [options] -o <output-dir>\n\n";
+    ss << "  -o <file_name> (or --output-dir <file_name>)  Folder for simulated data and benchmark report.\n";
+    ss << "  -t <list> (or --threads <list>)               Comma separated thread numbers to run benchmarks with. The default value is 1,8,32.\n";
+    ss << "  --genome-size <int>                           Size of simulated genome. The default value is 2000000.\n";
+    ss << "  --coverage <float>                            Coverage of simulated genome by reads. The default value is 20.\n";
+    ss << "  --seed <int>                                  Seed of the simulator. The default value is 239.\n";
+    ss << "  -k <int>                                      Value of k used for graph construction.\n";
+    ss << "  -w <int>                                      Window size used for minimizer selection.\n";
+    ss << "  -K <int>                                      Minimal length of exact match for read realignment.\n";
+    ss << "  --skip-polishing                              Do not run polishing benchmark.\n";
+    return ss.str();
+}
+
+int main(int argc, char **argv) {
+    CLParser parser({"output-dir=", "threads=1,8,32", "genome-size=2000000", "coverage=20", "seed=239",
+                     "k-mer-size=501", "window=2000", "K-mer-size=5001", "skip-polishing", "help"}, {},
+                    {"o=output-dir", "t=threads", "k=k-mer-size", "w=window", "K=K-mer-size", "h=help"},
+                    constructMessage());
+    parser.parseCL(argc, argv);
+    if (parser.getCheck("help")) {
+        std::cout << parser.message() << std::endl;
+        return 0;
+    }
+    if (!parser.check().empty()) {
+        std::cout << "Failed to parse command line parameters." << std::endl;
+        std::cout << parser.check() << "\n" << std::endl;
+        std::cout << parser.message() << std::endl;
+        return 1;
+    }
+    StringContig::homopolymer_compressing = true;
+    StringContig::SetDimerParameters("32,32,1");
+    const std::experimental::filesystem::path dir(parser.getValue("output-dir"));
+    ensure_dir_existance(dir);
+    logging::LoggerStorage ls(dir, "benchmarks");
+    logging::Logger logger;
+    logger.addLogFile(ls.newLoggerFile(), logging::trace);
+    for(int i = 0; i < argc; i++) {
+        logger << argv[i] << " ";
+    }
+    logger << std::endl;
+    size_t k = std::stoi(parser.getValue("k-mer-size"));
+    size_t w = std::stoi(parser.getValue("window"));
+    size_t K = std::stoi(parser.getValue("K-mer-size"));
+    std::vector<size_t> thread_nums;
+    for(const std::string &s : split(parser.getValue("threads"), ",")) {
+        thread_nums.push_back(std::stoull(s));
+    }
+    size_t max_threads = *std::max_element(thread_nums.begin(), thread_nums.end());
+
+    ReadSimulator simulator(std::stoull(parser.getValue("seed")));
+    simulator.genome_size = std::stoull(parser.getValue("genome-size"));
+    simulator.coverage = std::stod(parser.getValue("coverage"));
+    logger.info() << "Simulating genome of length " << simulator.genome_size << " and reads with coverage "
+                  << simulator.coverage << std::endl;
+    std::string genome = simulator.simulateGenome();
+    std::experimental::filesystem::path reads_file = dir / "reads.fastq";
+    size_t read_bases = simulator.simulateReads(genome, reads_file);
+    io::Library reads_lib = {reads_file};
+    logger.info() << "Simulated reads of total length " << read_bases << " printed to " << reads_file << std::endl;
+
+    std::vector<Contig> contigs;
+    Sequence compressed_genome = StringContig(std::string(genome), "genome").makeSequence();
+    size_t contig_len = 200000;
+    for(size_t pos = 0; pos < compressed_genome.size(); pos += contig_len) {
+        contigs.emplace_back(compressed_genome.Subseq(pos, std::min(compressed_genome.size(), pos + contig_len)),
+                             "contig" + itos(contigs.size()));
+    }
+    std::vector<Contig> contigs_and_rc;
+    for(const Contig &contig : contigs) {
+        contigs_and_rc.emplace_back(contig);
+        contigs_and_rc.emplace_back(contig.RC());
+    }
+    std::vector<Sequence> compressed_reads;
+    size_t compressed_read_bases = 0;
+    for(StringContig read : io::SeqReader(reads_lib)) {
+        compressed_reads.emplace_back(read.makeSequence());
+        compressed_read_bases += compressed_reads.back().size();
+    }
+
+    hashing::RollingHash hasher(k, 239);
+    logger.info() << "Preparing inputs of graph construction benchmarks" << std::endl;
+    std::vector<hashing::htype> hash_list = constructMinimizers(logger, reads_lib, max_threads, hasher, w);
+    std::vector<Sequence> disjointigs = constructDisjointigs(hasher, w, reads_lib, hash_list, max_threads, logger);
+    size_t disjointig_bases = total_size(disjointigs);
+    std::vector<hashing::htype> vertices = findJunctions(logger, disjointigs, hasher, max_threads);
+    std::experimental::filesystem::path alignments;
+    if(!parser.getCheck("skip-polishing")) {
+        io::SeqReader reader(reads_lib);
+        alignments = PrintAlignments(logger, max_threads, contigs, reader.begin(), reader.end(), K, dir / "alignments").first;
+    }
+
+    logging::StageTimer::SetStageFile(dir / "benchmark_stages.jsonl");
+    std::vector<BenchmarkResult> results;
+//    Memory held by a graph that refers to its own copy of disjointigs as in the pipeline, before and after freezing
+    std::vector<std::tuple<std::string, double, double>> memory;
+    {
+        double base_rss = currentRssMb();
+        double base_heap = currentHeapMb();
+        auto record = [&memory, base_rss, base_heap](const std::string &name) {
+            memory.emplace_back(name, currentRssMb() - base_rss, currentHeapMb() - base_heap);
+        };
+        std::vector<Sequence> own_disjointigs;
+        for(const Sequence &seq : disjointigs)
+            own_disjointigs.emplace_back(seq.copy());
+        SparseDBG graph = constructDBG(logger, vertices, own_disjointigs, hasher, max_threads);
+        own_disjointigs.clear();
+        record("SparseDBG");
+        {
+            FrozenGraph frozen(graph, max_threads);
+            record("SparseDBG+FrozenGraph");
+        }
+        record("SparseDBG after freezing");
+    }
+    for(size_t threads : thread_nums) {
+        measure(logger, "constructMinimizers", threads, read_bases, results, [&]() {
+            constructMinimizers(logger, reads_lib, threads, hasher, w);
+        });
+        measure(logger, "findJunctions", threads, disjointig_bases, results, [&]() {
+            findJunctions(logger, disjointigs, hasher, threads);
+        });
+        measure(logger, "constructDBG", threads, disjointig_bases, results, [&]() {
+            constructDBG(logger, vertices, disjointigs, hasher, threads);
+        });
+//        Same with the vertex store on the perfect hash that is not used by the pipeline by default
+        measure(logger, "constructDBG(perfect)", threads, disjointig_bases, results, [&]() {
+            constructDBG(logger, vertices, disjointigs, hasher, threads, true);
+        });
+        SparseDBG unmerged = constructUnmergedDBG(logger, vertices, disjointigs, hasher, threads);
+        size_t edge_bases = 0;
+        for(Edge &edge : unmerged.edges()) {
+            edge_bases += edge.size();
+        }
+        measure(logger, "mergeAll", threads, edge_bases, results, [&]() {
+            mergeAll(logger, unmerged, threads);
+        });
+        SparseDBG dbg = constructDBG(logger, vertices, disjointigs, hasher, threads);
+        dbg.fillAnchors(w, logger, threads);
+        measure(logger, "GraphAligner::align", threads, compressed_read_bases, results, [&]() {
+            std::function<void(size_t, Sequence &)> task = [&dbg](size_t pos, Sequence &seq) {
+                GraphAligner(dbg).align(seq);
+            };
+            processRecords(compressed_reads.begin(), compressed_reads.end(), logger, threads, task);
+        });
+        measure(logger, "RecordStorage::fill", threads, read_bases, results, [&]() {
+            ReadLogger readLogger(threads, dir / "read_log.txt");
+            RecordStorage readStorage(dbg, 0, std::max<size_t>(k * 2, 1000), threads, readLogger, true, false);
+            io::ReadLibrary(reads_lib, [&readStorage, &dbg, w, k, &logger, threads](auto begin, auto end) {
+                readStorage.fill(begin, end, dbg, w + k - 1, logger, threads);
+            });
+        });
+        measure(logger, "RecordStorage::fill(frozen)", threads, read_bases, results, [&]() {
+            FrozenGraph frozen(dbg, threads);
+            ReadLogger readLogger(threads, dir / "read_log.txt");
+            RecordStorage readStorage(dbg, 0, std::max<size_t>(k * 2, 1000), threads, readLogger, true, false);
+            io::ReadLibrary(reads_lib, [&readStorage, &frozen, w, k, &logger, threads](auto begin, auto end) {
+                readStorage.fill(begin, end, frozen, w + k - 1, logger, threads);
+            });
+        });
+        measure(logger, "RealignReads", threads, read_bases, results, [&]() {
+            io::SeqReader reader(reads_lib);
+            RealignReads(logger, threads, contigs_and_rc, reader.begin(), reader.end(), K);
+        });
+        if(!parser.getCheck("skip-polishing")) {
+            measure(logger, "Polish", threads, read_bases, results, [&]() {
+                Polish(logger, threads, contigs, alignments, reads_lib, StringContig::max_dimer_size / 2);
+            });
+        }
+    }
+    logging::StageTimer::WriteReport(dir / "benchmark_report.json");
+
+    std::stringstream table;
+    table << std::left << std::setw(30) << "benchmark" << std::setw(9) << "threads" << std::setw(12) << "time(s)"
+          << std::setw(14) << "Mbases/s" << "peak RSS(Mb)\n";
+    for(const BenchmarkResult &res : results) {
+        table << std::left << std::setw(30) << res.name << std::setw(9) << res.threads << std::setw(12)
+              << std::setprecision(4) << res.wall_sec << std::setw(14)
+              << (res.wall_sec > 0 ? double(res.bases) / res.wall_sec / 1000000 : 0) << res.peak_rss_mb << "\n";
+    }
+    table << "\n" << std::left << std::setw(30) << "graph" << std::setw(14) << "RSS(Mb)" << "heap(Mb)\n";
+    for(const std::tuple<std::string, double, double> &mem : memory)
+        table << std::left << std::setw(30) << std::get<0>(mem) << std::setw(14) << std::setprecision(4)
+              << std::get<1>(mem) << std::get<2>(mem) << "\n";
+    logger.info() << "Benchmark results:\n" << table.str();
+    logger.info() << "Full report can be found here: " << (dir / "benchmark_report.json") << std::endl;
+    return 0;
+}
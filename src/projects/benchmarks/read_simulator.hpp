@@ -0,0 +1,132 @@
+#pragma once
+
+#include <experimental/filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+//Deterministic simulator of a genome with repeats and of HiFi-like reads from it. The same seed always produces the same
+//genome and reads, so benchmark results of different builds can be compared.
+class ReadSimulator {
+private:
+    std::mt19937_64 rnd;
+
+    char randomNucl() {
+        return "ACGT"[rnd() % 4];
+    }
+
+    std::string randomSequence(size_t len) {
+        std::string res(len, 'A');
+        for(char &c : res)
+            c = randomNucl();
+        return std::move(res);
+    }
+
+//    Copies repeat with substitutions at given rate so that copies of the same repeat are not identical
+    std::string diverge(const std::string &repeat, double rate) {
+        std::string res = repeat;
+        std::uniform_real_distribution<double> coin(0, 1);
+        for(char &c : res) {
+            if(coin(rnd) < rate)
+                c = randomNucl();
+        }
+        return std::move(res);
+    }
+
+    static std::string reverseComplement(const std::string &s) {
+        std::string res(s.rbegin(), s.rend());
+        for(char &c : res) {
+            switch(c) {
+                case 'A': c = 'T'; break;
+                case 'C': c = 'G'; break;
+                case 'G': c = 'C'; break;
+                default: c = 'A';
+            }
+        }
+        return std::move(res);
+    }
+
+public:
+    size_t genome_size = 2000000;
+    size_t repeat_num = 20;
+    size_t repeat_len = 8000;
+    size_t repeat_copies = 3;
+    double repeat_divergence = 0.002;
+    size_t mean_read_len = 15000;
+    size_t read_len_deviation = 3000;
+    double coverage = 20;
+//    HiFi errors are mostly wrong lengths of homopolymers, substitutions are rare
+    double homopolymer_error_rate = 0.01;
+    double substitution_rate = 0.0001;
+
+    explicit ReadSimulator(uint64_t seed) : rnd(seed) {
+    }
+
+//    Random genome of genome_size bases where each of repeat_num repeats is inserted repeat_copies times with small
+//    divergence. Repeat copies replace random sequence so the genome size does not change.
+    std::string simulateGenome() {
+        std::string genome = randomSequence(genome_size);
+        if(genome_size <= repeat_len)
+            return std::move(genome);
+        for(size_t i = 0; i < repeat_num; i++) {
+            std::string repeat = randomSequence(repeat_len);
+            for(size_t j = 0; j < repeat_copies; j++) {
+                size_t pos = rnd() % (genome_size - repeat_len);
+                std::string copy = rnd() % 2 == 0 ? diverge(repeat, repeat_divergence) :
+                                   reverseComplement(diverge(repeat, repeat_divergence));
+                std::copy(copy.begin(), copy.end(), genome.begin() + pos);
+            }
+        }
+        return std::move(genome);
+    }
+
+//    Introduces HiFi-like errors: homopolymer runs are extended or shortened by one base and rare substitutions
+    std::string addErrors(const std::string &read) {
+        std::uniform_real_distribution<double> coin(0, 1);
+        std::string res;
+        res.reserve(read.size() + read.size() / 50);
+        size_t i = 0;
+        while(i < read.size()) {
+            size_t j = i;
+            while(j < read.size() && read[j] == read[i])
+                j++;
+            size_t len = j - i;
+            if(coin(rnd) < homopolymer_error_rate) {
+                if(rnd() % 2 == 0)
+                    len += 1;
+                else if(len > 1)
+                    len -= 1;
+            }
+            for(size_t l = 0; l < len; l++) {
+                res += coin(rnd) < substitution_rate ? randomNucl() : read[i];
+            }
+            i = j;
+        }
+        return std::move(res);
+    }
+
+//    Samples reads from both strands of the genome until the requested coverage is reached and prints them in fastq
+//    format. Returns total length of printed reads.
+    size_t simulateReads(const std::string &genome, const std::experimental::filesystem::path &fname) {
+        std::normal_distribution<double> len_distr{double(mean_read_len), double(read_len_deviation)};
+        std::ofstream os(fname);
+        size_t total = 0;
+        size_t cnt = 0;
+        while(double(total) < coverage * double(genome.size())) {
+            size_t len = size_t(std::max(1000.0, std::min(len_distr(rnd), double(genome.size()))));
+            size_t pos = rnd() % (genome.size() - len + 1);
+            std::string read = genome.substr(pos, len);
+            if(rnd() % 2 == 1)
+                read = reverseComplement(read);
+            read = addErrors(read);
+            os << "@read" << cnt << "_" << pos << "\n" << read << "\n+\n" << std::string(read.size(), 'I') << "\n";
+            total += read.size();
+            cnt++;
+        }
+        os.close();
+        return total;
+    }
+};
@@ -1,5 +1,6 @@
 #include "graph_stats.hpp"
 #include "dbg_construction.hpp"
+#include "graph_checkpoint.hpp"
 
 using namespace hashing;
 using namespace dbg;
@@ -18,8 +19,7 @@ using namespace dbg;
 std::vector<hashing::htype>
 findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher,
               size_t threads) {
-    bloom_parameters parameters;
-    parameters.projected_element_count = std::max(total_size(disjointigs) - hasher.getK() * disjointigs.size(), size_t(1000));
+    size_t projected_element_count = std::max(total_size(disjointigs) - hasher.getK() * disjointigs.size(), size_t(1000));
     std::vector<Sequence> split_disjointigs;
     for(const Sequence &seq : disjointigs) {
         if(seq.size() > hasher.getK() * 20) {
@@ -32,22 +32,14 @@ findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs,
             split_disjointigs.emplace_back(seq);
         }
     }
-    parameters.false_positive_probability = 0.0001;
-    VERIFY(!!parameters);
-    parameters.compute_optimal_parameters();
-    BloomFilter filter(parameters);//bloom过滤器
-//    DelayedBloomFilter filter(parameters, threads);
+    BlockedBloomFilter filter(projected_element_count, 0.0001);//bloom过滤器,每个元素只访问一个缓存行
     const hashing::RollingHash ehasher = hasher.extensionHash();//这里是滚动hash
     std::function<void(size_t, const Sequence &)> task = [&filter, &ehasher](size_t pos, const Sequence & seq) {
         if(seq.size() < ehasher.getK())
             return;
-        hashing::KWH kmer(ehasher, seq, 0);
-        while (true) {
-            filter.insert(kmer.hash());//将映射的hash值存储到 filter
-//            filter.delayedInsert(kmer.hash());
-            if (!kmer.hasNext())
-                break;
-            kmer = kmer.next();
+        hashing::KmerHashBuffer kmers(ehasher, seq);
+        for (size_t i = 0; i < kmers.size(); i++) {
+            filter.insert(kmers.hash(i));//将映射的hash值存储到 filter
         }
     };
     logger.info() << "Filling bloom filter with k+1-mers." << std::endl;
@@ -62,26 +54,21 @@ findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs,
     logger.info() << "Finished filling bloom filter. Selecting junctions." << std::endl;
     ParallelRecordCollector<hashing::htype> junctions(threads);
     std::function<void(size_t, const Sequence &)> junk_task = [&filter, &hasher, &junctions](size_t pos, const Sequence & seq) {
-        KWH kmer(hasher, seq, 0);
+        KmerHashBuffer kmers(hasher, seq);
+        VERIFY(kmers.size() > 0);
         size_t cnt = 0;
-        while (true) {
-            size_t cnt1 = 0;
-            size_t cnt2 = 0;
-            for (unsigned char c = 0; c < 4u; c++) {
-                cnt1 += filter.contains(kmer.extendRight(c));//计数
-                cnt2 += filter.contains(kmer.extendLeft(c));
-            }
+        for (size_t i = 0; i < kmers.size(); i++) {
+            unsigned char extensions = filter.containsExtensions(kmers[i]);//一次检查全部8个扩展
+            size_t cnt1 = __builtin_popcount(extensions & 15u);
+            size_t cnt2 = __builtin_popcount(extensions >> 4u);
             if (cnt1 != 1 || cnt2 != 1) {//只要有1个 != 1
                 cnt += 1;
-                junctions.emplace_back(kmer.hash());//就将当前kmer存放在连接点
+                junctions.emplace_back(kmers.hash(i));//就将当前kmer存放在连接点
             }
             VERIFY(cnt1 <= 4 && cnt2 <= 4);
-            if (!kmer.hasNext())
-                break;
-            kmer = kmer.next();
         }
         if (cnt == 0) {
-            junctions.emplace_back(KWH(hasher, seq, 0).hash());
+            junctions.emplace_back(kmers.hash(0));
         }
     };
 
@@ -94,9 +81,10 @@ findJunctions(logging::Logger &logger, const std::vector<Sequence> &disjointigs,
 }
 
 SparseDBG constructDBG(logging::Logger &logger, const std::vector<hashing::htype> &vertices, const std::vector<Sequence> &disjointigs,
-             const RollingHash &hasher, size_t threads) {
+             const RollingHash &hasher, size_t threads, bool perfect_vertex_index) {
     logger.info() << "Starting DBG construction." << std::endl;
-    SparseDBG dbg(vertices.begin(), vertices.end(), hasher);
+    SparseDBG dbg = perfect_vertex_index ? SparseDBG(vertices, hasher, threads) :
+                    SparseDBG(vertices.begin(), vertices.end(), hasher);
     logger.info() << "Vertices created." << std::endl;
     std::function<void(size_t, Sequence &)> edge_filling_task = [&dbg](size_t pos, Sequence & seq) {
         dbg.processRead(seq);
@@ -178,17 +166,30 @@ inline std::vector<htype> readHashs(std::istream &is) {
  * @param threads 线程数
  * @param disjointigs_file 不连续序列文件路径，若为"none"则不读取
  * @param vertices_file 顶点哈希值文件路径，若为"none"则不读取
+ * @param perfect_vertex_index 是否使用最小完美哈希存储顶点
+ * @param save_checkpoint 是否将构建好的图保存为二进制检查点dir/dbg.bin
+ *
+ * 若给定了disjointigs_file和vertices_file，且检查点完整并由相同的hasher、w和输入文件（按大小和修改时间比较）构建，则直接从检查点加载图。
  *
  * @return SparseDBG对象
  */
 SparseDBG DBGPipeline(logging::Logger &logger, const RollingHash &hasher, size_t w, const io::Library &lib,
                       const std::experimental::filesystem::path &dir, size_t threads, const string &disjointigs_file,
-                      const string &vertices_file) {
+                      const string &vertices_file, bool perfect_vertex_index, bool save_checkpoint) {
+    std::experimental::filesystem::path checkpoint = dir / "dbg.bin";
+    if (disjointigs_file != "none" && vertices_file != "none" &&
+            DBGCheckpoint::Check(checkpoint, hasher, w, DBGCheckpoint::Fingerprint({disjointigs_file, vertices_file}))) {
+        return DBGCheckpoint::Load(checkpoint, hasher, logger, threads);
+    }
     std::experimental::filesystem::path df;
     if (disjointigs_file == "none") {
         std::function<void()> task = [&logger, &lib, &threads, &w, &dir, &hasher]() {
             std::vector<hashing::htype> hash_list;
-            hash_list = constructMinimizers(logger, lib, threads, hasher, w);
+            {
+                logging::StageTimer timer("constructMinimizers");
+                hash_list = constructMinimizers(logger, lib, threads, hasher, w);
+            }
+            logging::StageTimer timer("constructDisjointigs");
             std::vector<Sequence> disjointigs = constructDisjointigs(hasher, w, lib, hash_list, threads, logger);
             hash_list.clear();
             std::ofstream df;
@@ -211,10 +212,13 @@ SparseDBG DBGPipeline(logging::Logger &logger, const RollingHash &hasher, size_t
         disjointigs.push_back(reader.read().makeSequence());
     }
     std::vector<hashing::htype> vertices;
+    std::experimental::filesystem::path vf;
     if (vertices_file == "none") {
+        logging::StageTimer timer("findJunctions");
         vertices = findJunctions(logger, disjointigs, hasher, threads);
+        vf = dir / "vertices.save";
         std::ofstream os;
-        os.open(std::string(dir.c_str()) + "/vertices.save");
+        os.open(vf);
         writeHashs(os, vertices);
         os.close();
     } else {
@@ -223,6 +227,14 @@ SparseDBG DBGPipeline(logging::Logger &logger, const RollingHash &hasher, size_t
         is.open(vertices_file);
         vertices = readHashs(is);
         is.close();
+        vf = vertices_file;
+    }
+    logging::StageTimer timer("constructDBG");
+    SparseDBG res = constructDBG(logger, vertices, disjointigs, hasher, threads, perfect_vertex_index);
+    timer.finish();
+    if (save_checkpoint) {
+        logger.info() << "Saving graph checkpoint to " << checkpoint << std::endl;
+        DBGCheckpoint::Save(checkpoint, res, w, DBGCheckpoint::Fingerprint({df, vf}));
     }
-    return std::move(constructDBG(logger, vertices, disjointigs, hasher, threads));
+    return std::move(res);
 }
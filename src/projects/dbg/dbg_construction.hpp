@@ -18,7 +18,9 @@
 std::vector<hashing::htype> findJunctions(logging::Logger & logger, const std::vector<Sequence>& disjointigs,
                                  const hashing::RollingHash &hasher, size_t threads);
 dbg::SparseDBG constructDBG(logging::Logger & logger, const std::vector<hashing::htype> &vertices,
-                       const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher, size_t threads);
+                       const std::vector<Sequence> &disjointigs, const hashing::RollingHash &hasher, size_t threads,
+                       bool perfect_vertex_index = false);
 dbg::SparseDBG DBGPipeline(logging::Logger & logger, const hashing::RollingHash &hasher, size_t w, const io::Library &lib,
                                 const std::experimental::filesystem::path &dir, size_t threads,
-                                const std::string& disjointigs_file = "none", const std::string &vertices_file = "none");
\ No newline at end of file
+                                const std::string& disjointigs_file = "none", const std::string &vertices_file = "none",
+                                bool perfect_vertex_index = false, bool save_checkpoint = false);
\ No newline at end of file
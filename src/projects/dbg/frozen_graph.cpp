@@ -0,0 +1,229 @@
+#include "frozen_graph.hpp"
+#include <sstream>
+
+using namespace dbg;
+
+constexpr FrozenGraph::id_type FrozenGraph::none;
+
+FrozenGraph::FrozenGraph(SparseDBG &dbg, size_t threads) : dbg_(&dbg), hasher_(dbg.hasher()) {
+    const size_t k = hasher_.getK();
+    std::vector<Vertex *> canonical;
+    for(auto &it : dbg) {
+        canonical.push_back(&it.second);
+    }
+    VERIFY(canonical.size() * 2 < none);
+    std::vector<hashing::htype> keys(canonical.size());
+    for(size_t i = 0; i < canonical.size(); i++) {
+        keys[i] = canonical[i]->hash();
+    }
+    mphf = hashing::MPHF(keys, threads);
+    hashes.resize(canonical.size());
+    vertex_ptrs.resize(canonical.size() * 2);
+    omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(canonical, keys)
+    for(size_t i = 0; i < canonical.size(); i++) {
+        size_t ind = mphf.lookup(keys[i]);
+        hashes[ind] = keys[i];
+        vertex_ptrs[ind * 2] = canonical[i];
+        vertex_ptrs[ind * 2 + 1] = &canonical[i]->rc();
+    }
+    canonical.clear();
+    canonical.shrink_to_fit();
+    keys.clear();
+    keys.shrink_to_fit();
+
+    edge_begin.resize(vertex_ptrs.size() + 1);
+    size_t edge_num = 0;
+    for(size_t v = 0; v < vertex_ptrs.size(); v++) {
+        edge_begin[v] = id_type(edge_num);
+        edge_num += vertex_ptrs[v]->outDeg();
+        VERIFY(edge_num < none);
+    }
+    edge_begin.back() = id_type(edge_num);
+    edges.resize(edge_num);
+    edge_ptrs.resize(edge_num);
+#pragma omp parallel for default(none) schedule(dynamic, 1024)
+    for(size_t v = 0; v < vertex_ptrs.size(); v++) {
+        Vertex &vertex = *vertex_ptrs[v];
+        VERIFY(vertex.seq.size() == hasher_.getK());
+        for(size_t j = 0; j < vertex.outDeg(); j++) {
+            id_type eid = edge_begin[v] + j;
+            Edge &edge = vertex[j];
+            VERIFY(edge.end() != nullptr);
+            VERIFY(edge.size() < none);
+            Edge &rc = edge.rc();
+            id_type rc_start = vertexId(*rc.start());
+            id_type rc_id = none;
+            for(id_type r = edge_begin[rc_start]; r < edge_begin[rc_start + 1]; r++) {
+                if(&(*vertex_ptrs[rc_start])[r - edge_begin[rc_start]] == &rc)
+                    rc_id = r;
+            }
+            VERIFY(rc_id != none);
+            edge_ptrs[eid] = &edge;
+            edges[eid] = {0, edge.intCov(), id_type(v), vertexId(*edge.end()), rc_id, uint32_t(edge.size()),
+                          (unsigned char)edge.seq[0], vertex.isCanonical(edge), false};
+        }
+    }
+
+//    Edges are laid out along walks in the graph. Full sequence of an edge that continues a walk starts with the end
+//    of the previous edge, so a walk stores one vertex sequence and then only edge sequences, and one edge of every
+//    rc pair is stored. Walks start at word boundaries so that they are packed by different threads. Vertices without
+//    edges form walks of their own.
+    struct Walk {
+        id_type start;
+        size_t begin;
+        size_t end;
+        uint64_t offset;
+        uint64_t size;
+    };
+    std::vector<Walk> walks;
+    std::vector<id_type> order;
+    std::vector<bool> used(edges.size(), false);
+    std::vector<id_type> next_out(edge_begin.begin(), edge_begin.end() - 1);
+    auto nextUnused = [this, &used, &next_out](id_type v) -> id_type {
+        while(next_out[v] < edge_begin[v + 1] && used[next_out[v]])
+            next_out[v]++;
+        return next_out[v] < edge_begin[v + 1] ? next_out[v] : none;
+    };
+    uint64_t total = 0;
+    auto addWalk = [this, k, &walks, &order, &used, &nextUnused, &total](id_type start) {
+        Walk walk = {start, order.size(), 0, total, k};
+        for(id_type e = nextUnused(start); e != none; e = nextUnused(edges[e].end)) {
+            EdgeRecord &rec = edges[e];
+            EdgeRecord &rc = edges[rec.rc];
+            used[e] = true;
+            used[rec.rc] = true;
+            rc.seq_offset = rec.seq_offset = total + walk.size - k;
+            rc.stored = false;
+            rec.stored = true;
+            order.push_back(e);
+            walk.size += rec.size;
+        }
+        walk.end = order.size();
+        walks.push_back(walk);
+        total += (walk.size + 31) / 32 * 32;
+    };
+//    Walks from vertices without incoming edges go first so that fewer walks are needed
+    for(id_type v = 0; v < vertex_ptrs.size(); v++) {
+        if(inDeg(v) == 0 && nextUnused(v) != none)
+            addWalk(v);
+    }
+    for(id_type v = 0; v < vertex_ptrs.size(); v++) {
+        while(nextUnused(v) != none)
+            addWalk(v);
+        if(v % 2 == 0 && outDeg(v) == 0 && inDeg(v) == 0)
+            addWalk(v);
+    }
+    used.clear();
+    used.shrink_to_fit();
+    next_out.clear();
+    next_out.shrink_to_fit();
+    arena = Sequence::fromPacked(total, [this, &walks, &order](uint64_t *words) {
+#pragma omp parallel
+        {
+            std::vector<unsigned char> buf;
+#pragma omp for schedule(dynamic, 1)
+            for(size_t i = 0; i < walks.size(); i++) {
+                const Walk &walk = walks[i];
+                uint64_t *out = words + walk.offset / 32;
+                std::fill(out, out + (walk.size + 31) / 32, uint64_t(0));
+                size_t pos = 0;
+                for(size_t j = walk.begin; j <= walk.end; j++) {
+                    const Sequence &seq = j == walk.begin ? vertex_ptrs[walk.start]->seq : edge_ptrs[order[j - 1]]->seq;
+                    buf.resize(seq.size());
+                    seq.unpack(buf.data());
+                    for(unsigned char c : buf) {
+                        out[pos / 32] |= uint64_t(c) << (pos % 32 * 2);
+                        pos++;
+                    }
+                }
+            }
+        }
+    });
+    order.clear();
+    order.shrink_to_fit();
+//    Sequences of the source graph are replaced with views of the arena. Before that they pointed into the
+//    disjointigs or had a buffer per edge, and all of that memory is released here.
+    for(const Walk &walk : walks) {
+        if(walk.begin != walk.end)
+            continue;
+        Vertex &vertex = *vertex_ptrs[walk.start];
+        vertex.seq = arena.Subseq(walk.offset, walk.offset + k);
+        vertex.rc().seq = !vertex.seq;
+    }
+#pragma omp parallel for default(none) schedule(dynamic, 1024)
+    for(size_t v = 0; v < vertex_ptrs.size(); v++) {
+        if(outDeg(v) == 0 && inDeg(v) == 0)
+            continue;
+        vertex_ptrs[v]->seq = vertexSeq(id_type(v));
+        for(id_type e = firstOutgoing(v); e < lastOutgoing(v); e++)
+            edge_ptrs[e]->seq = edgeSeq(e);
+    }
+}
+
+Sequence FrozenGraph::fullSeq(id_type e) const {
+    const EdgeRecord &rec = edges[e];
+    Sequence res = arena.Subseq(rec.seq_offset, rec.seq_offset + hasher_.getK() + rec.size);
+    return rec.stored ? res : !res;
+}
+
+Sequence FrozenGraph::edgeSeq(id_type e) const {
+    return fullSeq(e).Subseq(hasher_.getK());
+}
+
+Sequence FrozenGraph::vertexSeq(id_type v) const {
+    size_t k = hasher_.getK();
+    if(outDeg(v) > 0)
+        return fullSeq(firstOutgoing(v)).Subseq(0, k);
+    if(inDeg(v) > 0)
+        return !fullSeq(firstOutgoing(rcVertex(v))).Subseq(0, k);
+    return vertex(v).seq;
+}
+
+std::string FrozenGraph::oldId(id_type e) const {
+    std::stringstream ss;
+    id_type v = start(e);
+    ss << hash(v) << isCanonical(v) << "ACGT"[firstNucl(e)];
+    return ss.str();
+}
+
+GraphAlignment FrozenGraph::align(const Sequence &seq) const {
+    size_t k = hasher_.getK();
+    hashing::KWH kwh(hasher_, seq, 0);
+    id_type cur = vertexId(kwh);
+    while(cur == none && kwh.hasNext()) {
+        kwh = kwh.next();
+        cur = vertexId(kwh);
+    }
+    if(cur == none) {
+        GraphAligner aligner(*dbg_);
+        return aligner.align(seq);
+    }
+    std::vector<Segment<Edge>> res;
+    if(kwh.pos > 0) {
+        id_type rcedge = outgoing(rcVertex(cur), seq[kwh.pos - 1] ^ 3u);
+        if(rcedge == none) {
+            std::cout << "No outgoing for start" << std::endl << seq << std::endl << kwh.pos << std::endl;
+            VERIFY(false);
+        }
+        id_type eid = rcEdge(rcedge);
+        VERIFY(size(eid) >= kwh.pos);
+        res.emplace_back(edge(eid), size(eid) - kwh.pos, size(eid));
+    }
+    size_t cpos = kwh.pos + k;
+    while(cpos < seq.size()) {
+        id_type next = outgoing(cur, seq[cpos]);
+        if(next == none) {
+            std::cout << "No outgoing for middle\n" << seq << "\n" << cpos << " " << vertex(cur).getId() << std::endl;
+            VERIFY(false);
+        }
+        size_t len = std::min<size_t>(size(next), seq.size() - cpos);
+        res.emplace_back(edge(next), 0, len);
+        cpos += len;
+        cur = end(next);
+    }
+    if(res.empty())
+        return {};
+    Vertex *first = res.front().contig().start();
+    return {first, std::move(res)};
+}
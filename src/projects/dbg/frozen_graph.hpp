@@ -0,0 +1,104 @@
+#pragma once
+#include "paths.hpp"
+#include "sparse_dbg.hpp"
+#include "common/perfect_hash.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace dbg {
+/*
+ * Read-only compacted copy of SparseDBG for stages that only walk the graph. Vertices and edges get 32-bit ids.
+ * Vertex with canonical hash h gets id 2 * mphf(h) and its reverse-complement gets the next id, so rc of vertex v is
+ * v ^ 1. Outgoing edges of vertex v occupy the contiguous id range [edge_begin[v], edge_begin[v + 1]).
+ * Sequences are packed into a single Sequence arena along walks in the graph so that every edge pair and the vertices
+ * between consecutive edges of a walk are stored once. Full sequence (start vertex sequence + edge sequence) of each
+ * edge is a view of the arena or the rc of one. Construction replaces vertex and edge sequences of the source graph
+ * with views of this arena. The graph then no longer keeps the disjointigs or the separate buffers it was built from.
+ * The arena stays alive with the graph after the frozen copy is destroyed.
+ * Each id maps back to the original Vertex/Edge so that results can be used with the rest of the pipeline.
+ * Coverages are copied at construction and are not updated afterwards.
+ * Anchors are not copied, alignment of sequences that contain no vertex falls back to the anchors of the original graph.
+ */
+    class FrozenGraph {
+    public:
+        typedef uint32_t id_type;
+        static constexpr id_type none = id_type(-1);
+    private:
+        struct EdgeRecord {
+            uint64_t seq_offset;
+            uint64_t cov;
+            id_type start;
+            id_type end;
+            id_type rc;
+            uint32_t size;
+            unsigned char first_nucl;
+            bool canonical;
+//            seq_offset points to the full sequence of this edge and not of its rc
+            bool stored;
+        };
+
+        SparseDBG *dbg_;
+        hashing::RollingHash hasher_;
+        hashing::MPHF mphf;
+        std::vector<hashing::htype> hashes;
+        std::vector<id_type> edge_begin;
+        std::vector<EdgeRecord> edges;
+        std::vector<Vertex *> vertex_ptrs;
+        std::vector<Edge *> edge_ptrs;
+        Sequence arena;
+
+    public:
+        FrozenGraph(SparseDBG &dbg, size_t threads);
+        FrozenGraph(FrozenGraph &&other) = default;
+        FrozenGraph(const FrozenGraph &other) = delete;
+
+        SparseDBG &graph() const {return *dbg_;}
+        const hashing::RollingHash &hasher() const {return hasher_;}
+        size_t vertexCount() const {return vertex_ptrs.size();}
+        size_t edgeCount() const {return edges.size();}
+
+        id_type vertexId(const hashing::htype &hash, bool canonical) const {
+            size_t ind = mphf.lookup(hash);
+            if(ind >= hashes.size() || hashes[ind] != hash)
+                return none;
+            return id_type(ind * 2 + (canonical ? 0 : 1));
+        }
+        id_type vertexId(const hashing::KWH &kwh) const {return vertexId(kwh.hash(), kwh.isCanonical());}
+        id_type vertexId(const Vertex &vertex) const {return vertexId(vertex.hash(), vertex.isCanonical());}
+        hashing::htype hash(id_type v) const {return hashes[v / 2];}
+        bool isCanonical(id_type v) const {return (v & 1u) == 0;}
+        id_type rcVertex(id_type v) const {return v ^ 1u;}
+        size_t outDeg(id_type v) const {return edge_begin[v + 1] - edge_begin[v];}
+        size_t inDeg(id_type v) const {return outDeg(rcVertex(v));}
+        id_type firstOutgoing(id_type v) const {return edge_begin[v];}
+        id_type lastOutgoing(id_type v) const {return edge_begin[v + 1];}
+        id_type outgoing(id_type v, unsigned char c) const {
+            for(id_type e = edge_begin[v]; e < edge_begin[v + 1]; e++)
+                if(edges[e].first_nucl == c)
+                    return e;
+            return none;
+        }
+        Sequence vertexSeq(id_type v) const;
+
+        id_type start(id_type e) const {return edges[e].start;}
+        id_type end(id_type e) const {return edges[e].end;}
+        id_type rcEdge(id_type e) const {return edges[e].rc;}
+        size_t size(id_type e) const {return edges[e].size;}
+        unsigned char firstNucl(id_type e) const {return edges[e].first_nucl;}
+        size_t intCov(id_type e) const {return edges[e].cov;}
+        double getCoverage(id_type e) const {return double(edges[e].cov) / edges[e].size;}
+//        Same as Vertex::isCanonical(const Edge &) for the original edge
+        bool isCanonicalEdge(id_type e) const {return edges[e].canonical;}
+//        Sequence of the edge without the start vertex
+        Sequence edgeSeq(id_type e) const;
+//        Sequence of the start vertex followed by the sequence of the edge
+        Sequence fullSeq(id_type e) const;
+        std::string oldId(id_type e) const;
+
+        Vertex &vertex(id_type v) const {return *vertex_ptrs[v];}
+        Edge &edge(id_type e) const {return *edge_ptrs[e];}
+
+//        Same result as GraphAligner::align(seq) for the original graph
+        GraphAlignment align(const Sequence &seq) const;
+    };
+}
@@ -33,9 +33,10 @@ namespace dbg {
         logger.info() << "Starting construction of sparse de Bruijn graph" << std::endl;
         SparseDBG sdbg(hash_list.begin(), hash_list.end(), hasher);
         logger.info() << "Vertex map constructed." << std::endl;
-        io::SeqReader reader(reads_file, (hasher.getK() + w) * 20, (hasher.getK() + w) * 4);
         logger.info() << "Filling edge sequences." << std::endl;
-        FillSparseDBGEdges(sdbg, reader.begin(), reader.end(), logger, threads, w + hasher.getK() - 1);
+        io::ReadLibrary(reads_file, [&sdbg, &logger, threads, &hasher, w](auto begin, auto end) {
+            FillSparseDBGEdges(sdbg, begin, end, logger, threads, w + hasher.getK() - 1);
+        }, (hasher.getK() + w) * 20, (hasher.getK() + w) * 4);
         logger.info() << "Finished sparse de Bruijn graph construction." << std::endl;
         return std::move(sdbg);
     }
@@ -159,84 +160,110 @@ namespace dbg {
         rc_new_edge.incCov(cov - rc_new_edge.intCov());
     }
 
-    void MergeEdge(SparseDBG &sdbg, Vertex &start, Edge &edge) {
+//    Full sequence of an unbranching path that starts at a junction. first is the path edge in the outgoing list of
+//    the start vertex and last_rc is the reverse complement of the last path edge in the outgoing list of the end
+//    vertex. Both are replaced with the merged edge and its reverse complement.
+    struct ChainMerge {
+        Edge *first;
+        Edge *last_rc;
+        Sequence seq;
+        size_t cov;
+    };
+
+    static Vertex &canonicalVertex(Vertex &vertex) {
+        return vertex.isCanonical() ? vertex : vertex.rc();
+    }
+
+    static void collectChain(Edge &edge, ParallelRecordCollector<ChainMerge> &merges) {
         Path path = Path::WalkForward(edge);
-        Vertex &end = path.finish().rc();
-        if (path.size() > 1 && end.hash() >= start.hash()) {
-            VERIFY(start.seq.size() > 0)
-            VERIFY(end.seq.size() > 0);
-            Sequence newSeq(path.Seq());
-            if (start != end)
-                end.lock();
-            size_t cov = 0;
-            for (size_t i = 0; i + 1 < path.size(); i++) {
-//            path[i].end()->clear();
-                path[i].end()->mark();
-                path[i].end()->rc().mark();
-                cov += path[i].intCov();
-            }
-            cov += path.back().intCov();
-            Edge &new_edge = start.addEdgeLockFree(Edge(&start, &end.rc(), newSeq.Subseq(start.seq.size())));
-            Edge &rc_new_edge = end.addEdgeLockFree(Edge(&end, &start.rc(), (!newSeq).Subseq(start.seq.size())));
-            new_edge.incCov(cov - new_edge.intCov());
-            rc_new_edge.incCov(cov - rc_new_edge.intCov());
-            if (start != end)
-                end.unlock();
+        if (path.size() <= 1)
+            return;
+//        The path is reached from both of its ends. Walks from both sides choose the same inner vertex and only the
+//        walk that marks it first merges the path.
+        Vertex &first_inner = canonicalVertex(path.getVertex(1));
+        Vertex &last_inner = canonicalVertex(path.getVertex(path.size() - 1));
+        Vertex &owner = first_inner.hash() <= last_inner.hash() ? first_inner : last_inner;
+        if (!owner.claim())
+            return;
+        VERIFY(path.start().seq.size() > 0);
+        VERIFY(path.finish().seq.size() > 0);
+        size_t cov = 0;
+        for (size_t i = 0; i + 1 < path.size(); i++) {
+            path[i].end()->mark();
+            path[i].end()->rc().mark();
+            cov += path[i].intCov();
         }
+        cov += path.back().intCov();
+        merges.emplace_back(ChainMerge{&edge, &path.back().rc(), path.Seq(), cov});
+    }
+
+//    Every edge slot belongs to exactly one path and outgoing lists do not change size so slots are replaced in
+//    parallel without locks.
+    static void applyChainMerges(logging::Logger &logger, size_t threads, ParallelRecordCollector<ChainMerge> &merges) {
+        logger.trace() << "Collected " << merges.size() << " unbranching paths" << std::endl;
+        std::function<void(size_t, ChainMerge &)> merge_task = [](size_t pos, ChainMerge &merge) {
+            Vertex &start = *merge.first->start();
+            Vertex &end = *merge.last_rc->start();
+            size_t k = start.seq.size();
+            Sequence rc_seq = !merge.seq;
+            *merge.first = Edge(&start, &end.rc(), merge.seq.Subseq(k));
+            merge.first->incCov(merge.cov);
+            if (merge.last_rc != merge.first) {
+                *merge.last_rc = Edge(&end, &start.rc(), rc_seq.Subseq(k));
+                merge.last_rc->incCov(merge.cov);
+            }
+            merge.seq = {};
+        };
+        processObjects(merges.begin(), merges.end(), logger, threads, merge_task);
     }
 
     void mergeLinearPaths(logging::Logger &logger, SparseDBG &sdbg, size_t threads) {
         logger.trace() << "Merging linear unbranching paths" << std::endl;
-        std::function<void(size_t, std::pair<const htype, Vertex> &)> task =
-                [&sdbg](size_t pos, std::pair<const htype, Vertex> &pair) {
+//        Paths are collected first without changing the graph so that walks never see a half merged path.
+        ParallelRecordCollector<ChainMerge> merges(threads);
+        std::function<void(size_t, std::pair<const htype, Vertex> &)> collect_task =
+                [&merges](size_t pos, std::pair<const htype, Vertex> &pair) {
                     Vertex &start = pair.second;
                     if (!start.isJunction())
                         return;
-                    start.lock();
                     for (Edge &edge: start) {
-                        MergeEdge(sdbg, start, edge);
+                        collectChain(edge, merges);
                     }
-                    start.unlock();
-                    start.rc().lock();
                     for (Edge &edge: start.rc()) {
-                        MergeEdge(sdbg, start.rc(), edge);
+                        collectChain(edge, merges);
                     }
-                    start.rc().unlock();
                 };
-        processObjects(sdbg.begin(), sdbg.end(), logger, threads, task);
+        processObjects(sdbg.begin(), sdbg.end(), logger, threads, collect_task);
+        applyChainMerges(logger, threads, merges);
         logger.trace() << "Finished merging linear unbranching paths" << std::endl;
     }
 
     void mergeCyclicPaths(logging::Logger &logger, SparseDBG &sdbg, size_t threads) {
         logger.trace() << "Merging cyclic paths" << std::endl;
-        ParallelRecordCollector<htype> loops(threads);
+        ParallelRecordCollector<Vertex *> loops(threads);
+//        Each perfect loop is merged from its vertex with the smallest hash. Walks stop as soon as they see a smaller
+//        hash so long loops are not traversed from every vertex.
         std::function<void(size_t, std::pair<const htype, Vertex> &)> task =
-                [&sdbg, &loops](size_t pos, std::pair<const htype, Vertex> &pair) {
+                [&loops](size_t pos, std::pair<const htype, Vertex> &pair) {
                     Vertex &start = pair.second;
                     if (start.isJunction() || start.marked()) {
                         return;
                     }
-                    Path path = Path::WalkForward(start[0]);
-                    VERIFY(path.finish() == start);
-                    bool ismin = true;
-                    for (const Edge *e: path) {
-                        if (e->end()->hash() < start.hash()) {
-                            ismin = false;
-                            break;
-                        }
+                    Vertex *next = start[0].end();
+                    while (*next != start) {
+                        VERIFY(!next->isJunction());
+                        if (next->hash() < start.hash())
+                            return;
+                        next = (*next)[0].end();
                     }
-                    if (ismin) {
-                        loops.emplace_back(start.hash());
-                    }
-                    start.unlock();
+                    loops.emplace_back(&start);
                 };
         processObjects(sdbg.begin(), sdbg.end(), logger, threads, task);
         logger.trace() << "Found " << loops.size() << " perfect loops" << std::endl;
-        for (htype loop: loops) {
-            Vertex &start = sdbg.getVertex(loop);
-            Path path = Path::WalkForward(start[0]);
-            mergeLoop(path);
-        }
+        std::function<void(size_t, Vertex *&)> merge_task = [](size_t pos, Vertex *&start) {
+            mergeLoop(Path::WalkForward((*start)[0]));
+        };
+        processObjects(loops.begin(), loops.end(), logger, threads, merge_task);
         logger.trace() << "Finished merging cyclic paths" << std::endl;
     }
 
@@ -252,11 +279,62 @@ namespace dbg {
         logger.trace() << "Finished merging unbranching paths" << std::endl;
     }
 
+    void mergeAll(logging::Logger &logger, SparseDBG &sdbg, size_t threads, std::vector<Vertex *> vertices) {
+        logger.trace() << "Merging unbranching paths through " << vertices.size() << " vertices" << std::endl;
+//        Walk back from every unbranching vertex to the junction where its path starts. Each vertex is visited once so
+//        that long paths with many changed vertices are not traversed many times.
+        std::unordered_map<Vertex *, size_t> visited;
+        std::vector<Vertex *> starts;
+        ParallelRecordCollector<Vertex *> loops(threads);
+        size_t walk = 0;
+        for (Vertex *vertex: vertices) {
+            for (Vertex *cur: {vertex, &vertex->rc()}) {
+                walk++;
+                while (!cur->isJunction()) {
+                    auto it = visited.emplace(cur, walk);
+                    if (!it.second) {
+                        if (it.first->second == walk) {
+//                            Perfect loop. It is merged from the same vertex that mergeCyclicPaths would choose.
+                            Vertex *min = cur;
+                            for (Vertex *next = cur->begin()->end(); next != cur; next = next->begin()->end()) {
+                                if (next->hash() < min->hash())
+                                    min = next;
+                            }
+                            loops.emplace_back(min->isCanonical() ? min : &min->rc());
+                        }
+                        break;
+                    }
+                    cur = &cur->rc().begin()->end()->rc();
+                    if (cur->isJunction())
+                        starts.emplace_back(cur);
+                }
+            }
+        }
+        ParallelRecordCollector<ChainMerge> merges(threads);
+        std::function<void(size_t, Vertex *&)> collect_task = [&merges](size_t pos, Vertex *&start) {
+            for (Edge &edge: *start) {
+                collectChain(edge, merges);
+            }
+        };
+        processObjects(starts.begin(), starts.end(), logger, threads, collect_task);
+        applyChainMerges(logger, threads, merges);
+        std::vector<Vertex *> loop_starts = loops.collectUnique();
+        logger.trace() << "Found " << loop_starts.size() << " perfect loops" << std::endl;
+        std::function<void(size_t, Vertex *&)> loop_task = [](size_t pos, Vertex *&start) {
+            mergeLoop(Path::WalkForward((*start)[0]));
+        };
+        processObjects(loop_starts.begin(), loop_starts.end(), logger, threads, loop_task);
+        logger.trace() << "Removing isolated vertices" << std::endl;
+        sdbg.removeMarked();
+        logger.trace() << "Finished merging unbranching paths" << std::endl;
+    }
+
     void CalculateCoverage(const std::experimental::filesystem::path &dir, const RollingHash &hasher, const size_t w,
                            const io::Library &lib, size_t threads, logging::Logger &logger, SparseDBG &dbg) {
         logger.info() << "Calculating edge coverage." << std::endl;
-        io::SeqReader reader(lib);
-        fillCoverage(dbg, logger, reader.begin(), reader.end(), threads, hasher, w + hasher.getK() - 1);
+        io::ReadLibrary(lib, [&dbg, &logger, threads, &hasher, w](auto begin, auto end) {
+            fillCoverage(dbg, logger, begin, end, threads, hasher, w + hasher.getK() - 1);
+        });
         std::ofstream os;
         os.open(dir / "coverages.save");
         os << dbg.size() << std::endl;
@@ -47,14 +47,16 @@ namespace dbg {
 
     void mergeLoop(Path path);
 
-    void MergeEdge(SparseDBG &sdbg, Vertex &start, Edge &edge);
-
     void mergeLinearPaths(logging::Logger &logger, SparseDBG &sdbg, size_t threads);
 
     void mergeCyclicPaths(logging::Logger &logger, SparseDBG &sdbg, size_t threads);
 
     void mergeAll(logging::Logger &logger, SparseDBG &sdbg, size_t threads);
 
+//    Same as mergeAll but only merges unbranching paths that pass through the given vertices or their reverse
+//    complements. Used after local changes of a graph that was merged before.
+    void mergeAll(logging::Logger &logger, SparseDBG &sdbg, size_t threads, std::vector<Vertex *> vertices);
+
     void CalculateCoverage(const std::experimental::filesystem::path &dir, const hashing::RollingHash &hasher,
                            const size_t w,
                            const io::Library &lib, size_t threads, logging::Logger &logger, SparseDBG &dbg);
@@ -20,33 +20,13 @@ void AlignedRead::invalidate() {
 void VertexRecord::addPath(const Sequence &seq) {
     lock();
     cov += 1;
-    for(std::pair<Sequence, size_t> &path : paths) {
-        if(path.first == seq) {
-            path.second += 1;
-            if(path.second == 1)
-                zero_cnt -= 1;
-            unlock();
-            return;
-        }
-    }
-    paths.emplace_back(seq, 1);
+    paths.add(seq);
     unlock();
 }
 
 void VertexRecord::removePath(const Sequence &seq) {
     lock();
-    bool found = false;
-    for(std::pair<Sequence, size_t> &path : paths) {
-        if(path.first == seq) {
-            found = true;
-            VERIFY(path.second > 0);
-            path.second -= 1;
-            cov -= 1;
-            if(path.second == 0)
-                zero_cnt += 1;
-            break;
-        }
-    }
+    bool found = paths.remove(seq);
     if(!found) {
         std::cout << "Error" << std::endl;
         unlock();
@@ -54,52 +34,32 @@ void VertexRecord::removePath(const Sequence &seq) {
         std::cout << this->str() << std::endl;
     }
     VERIFY(found);
-    if(zero_cnt > paths.size() / 3) {
-        std::vector<std::pair<Sequence, size_t>> new_paths;
-        for(std::pair<Sequence, size_t> &rec : paths) {
-            if(rec.second != 0) {
-                new_paths.emplace_back(std::move(rec.first), rec.second);
-            }
-        }
-        std::swap(paths, new_paths);
-        zero_cnt = 0;
-    }
+    cov -= 1;
     unlock();
 }
 
 bool VertexRecord::isDisconnected(const Edge &edge) const {
     if(edge.end()->outDeg() == 0)
         return false;
-    for(const std::pair<Sequence, size_t> &rec : paths) { // NOLINT(readability-use-anyofallof)
-        if(rec.second > 0 && rec.first[0] == edge.seq[0] && rec.first.size() > 1)
-            return false;
-    }
-    return true;
+    std::array<size_t, 4> counts = paths.countExtensions(edge.seq.Subseq(0, 1));
+    return counts[0] + counts[1] + counts[2] + counts[3] == 0;
 }
 
 size_t VertexRecord::countStartsWith(const Sequence &seq) const {
-//        lock();
-    size_t cnt = 0;
-    for(const std::pair<Sequence, size_t> &rec : paths) {
-        if(rec.first.startsWith(seq)) {
-            cnt += rec.second;
-        }
-    }
-//        unlock();
-    return cnt;
+    return paths.countStartsWith(seq);
 }
 
 std::vector<GraphAlignment> VertexRecord::getBulgeAlternatives(const Vertex &end, double threshold) const {
 //        lock();
     std::vector<std::pair<Sequence, size_t>> candidates;
-    for(const auto & extension : paths) {
-        Path unpacked = CompactPath(v, extension.first).getPath();
+    paths.forEach([this, &end, &candidates](const Sequence &extension, size_t cnt) {
+        Path unpacked = CompactPath(v, extension).getPath();
         for(size_t i = 1; i <= unpacked.size(); i++) {
             if(end == unpacked.getVertex(i)){
-                candidates.emplace_back(extension.first.Subseq(0, i), extension.second);
+                candidates.emplace_back(extension.Subseq(0, i), cnt);
             }
         }
-    }
+    });
 //        unlock();
     if(candidates.empty())
         return {};
@@ -119,25 +79,8 @@ std::vector<GraphAlignment> VertexRecord::getBulgeAlternatives(const Vertex &end
     return std::move(res);
 }
 
-CompactPath VertexRecord::getFullUniqueExtension(const Sequence &start, size_t min_good_cov, size_t max_bad_cov) const {
-    Sequence res = start;
-    while(true) {
-        unsigned char next = getUniqueExtension(res, min_good_cov, max_bad_cov);
-        if(next == (unsigned char)-1)
-            break;
-        std::vector<unsigned char> ext = {next};
-        res = res + Sequence(ext);
-    }
-    return {v, res};
-}
-
-unsigned char VertexRecord::getUniqueExtension(const Sequence &start, size_t min_good, size_t max_bad) const {
-    std::vector<size_t> counts(4);
-    for(const auto & extension : paths) {
-        if(extension.first.size() > start.size() && extension.first.startsWith(start)) {
-            counts[extension.first[start.size()]] += extension.second;
-        }
-    }
+//Returns the only nucleotide with at least min_good paths if all other nucleotides have at most max_bad paths
+static unsigned char uniqueExtension(const std::array<size_t, 4> &counts, size_t min_good, size_t max_bad) {
     size_t bad = 0;
     size_t good = 0;
     size_t res = 0;
@@ -154,17 +97,35 @@ unsigned char VertexRecord::getUniqueExtension(const Sequence &start, size_t min
     return (unsigned char)(res);
 }
 
+CompactPath VertexRecord::getFullUniqueExtension(const Sequence &start, size_t min_good_cov, size_t max_bad_cov) const {
+    std::vector<unsigned char> ext;
+//    The cursor follows the extension in the path tree so every step costs O(1) and no intermediate paths are built
+    PathTrie::Cursor cursor = paths.find(start);
+    while(true) {
+        unsigned char next = uniqueExtension(paths.countExtensions(cursor), min_good_cov, max_bad_cov);
+        if(next == (unsigned char)-1)
+            break;
+        ext.emplace_back(next);
+        paths.advance(cursor, next);
+    }
+    return {v, start + Sequence(ext)};
+}
+
+unsigned char VertexRecord::getUniqueExtension(const Sequence &start, size_t min_good, size_t max_bad) const {
+    return uniqueExtension(paths.countExtensions(start), min_good, max_bad);
+}
+
 std::vector<GraphAlignment> VertexRecord::getTipAlternatives(size_t len, double threshold) const {
     len += std::max<size_t>(30, len / 20);
 //        lock();
     std::vector<std::pair<Sequence, size_t>> candidates;
-    for(const auto & extension : paths) {
-        GraphAlignment unpacked = CompactPath(v, extension.first).getAlignment();
+    paths.forEach([this, len, &candidates](const Sequence &extension, size_t cnt) {
+        GraphAlignment unpacked = CompactPath(v, extension).getAlignment();
         if(unpacked.len() >= len) {
             unpacked.cutBack(unpacked.len() - len);
-            candidates.emplace_back(CompactPath(unpacked).cpath(), extension.second);
+            candidates.emplace_back(CompactPath(unpacked).cpath(), cnt);
         }
-    }
+    });
 //        unlock();
     if(candidates.empty())
         return {};
@@ -193,9 +154,9 @@ std::vector<GraphAlignment> VertexRecord::getTipAlternatives(size_t len, double
 std::string VertexRecord::str() const {
     std::stringstream ss;
     lock();
-    for(const auto & path : paths) {
-        ss << path.first << " " << path.second << std::endl;
-    }
+    paths.forEach([&ss](const Sequence &path, size_t cnt) {
+        ss << path << " " << cnt << std::endl;
+    });
     unlock();
     return ss.str();
 }
@@ -299,10 +260,44 @@ void RecordStorage::processPath(const CompactPath &cpath, const std::function<vo
 RecordStorage::RecordStorage(SparseDBG &dbg, size_t _min_len, size_t _max_len, size_t threads,
                              ReadLogger &readLogger, bool _track_cov, bool log_changes, bool track_suffixes) :
         min_len(_min_len), max_len(_max_len), track_cov(_track_cov), readLogger(&readLogger), log_changes(log_changes), track_suffixes(track_suffixes) {
+    data.reserve(dbg.size() * 2);
     for(auto &it : dbg) {
-        data.emplace(&it.second, VertexRecord(it.second));
-        data.emplace(&it.second.rc(), VertexRecord(it.second.rc()));
+        data.emplace_back(it.second);
+        data.emplace_back(it.second.rc());
+    }
+    VERIFY(data.size() < NO_RECORD);
+    size_t index_size = 2;
+    index_shift = 63;
+    while(index_size < data.size() * 2) {
+        index_size *= 2;
+        index_shift -= 1;
     }
+    index.resize(index_size, uint32_t(NO_RECORD));
+    for(size_t i = 0; i < data.size(); i++) {
+        size_t pos = slot(&data[i].v);
+        while(index[pos] != NO_RECORD)
+            pos = (pos + 1) & (index_size - 1);
+        index[pos] = uint32_t(i);
+    }
+}
+
+size_t RecordStorage::recordIndex(const Vertex &v) const {
+    size_t pos = slot(&v);
+    while(true) {
+        uint32_t rec = index[pos];
+        VERIFY(rec != NO_RECORD);
+        if(&data[rec].v == &v)
+            return rec;
+        pos = (pos + 1) & (index.size() - 1);
+    }
+}
+
+VertexRecord &RecordStorage::record(const Vertex &v) {
+    return data[recordIndex(v)];
+}
+
+const VertexRecord &RecordStorage::record(const Vertex &v) const {
+    return data[recordIndex(v)];
 }
 
 std::function<std::string(Edge &)> RecordStorage::labeler() const {
@@ -310,10 +305,10 @@ std::function<std::string(Edge &)> RecordStorage::labeler() const {
         return [this](Edge &edge) {
             const VertexRecord &rec = getRecord(*edge.start());
             std::stringstream ss;
-            for (const auto &ext : rec) {
-                if (ext.first[0] == edge.seq[0])
-                    ss << ext.first << "(" << ext.second << ")\\n";
-            }
+            rec.forEachPath([&ss, &edge](const Sequence &ext, size_t cnt) {
+                if (ext.size() > 0 && ext[0] == edge.seq[0])
+                    ss << ext << "(" << cnt << ")\\n";
+            });
             return ss.str();
         };
     else return [](Edge &) {
@@ -385,7 +380,7 @@ void RecordStorage::addSubpath(const CompactPath &cpath) {
     std::function<void(Vertex &, const Sequence &)> vertex_task = [](Vertex &v, const Sequence &s) {};
     if(track_suffixes)
         vertex_task = [this](Vertex &v, const Sequence &s) {
-            data.find(&v)->second.addPath(s);
+            record(v).addPath(s);
         };
     std::function<void(Segment<Edge>)> edge_task = [](Segment<Edge> seg){};
     if(track_cov)
@@ -401,7 +396,7 @@ void RecordStorage::removeSubpath(const CompactPath &cpath) {
     std::function<void(Vertex &, const Sequence &)> vertex_task = [](Vertex &v, const Sequence &s) {};
     if(track_suffixes)
         vertex_task = [this](Vertex &v, const Sequence &s) {
-            data.find(&v)->second.removePath(s);
+            record(v).removePath(s);
         };
     std::function<void(Segment<Edge>)> edge_task = [](Segment<Edge> seg){};
     if(track_cov)
@@ -513,7 +508,7 @@ void RecordStorage::printFullAlignments(logging::Logger &logger, const std::expe
 
 const VertexRecord &RecordStorage::getRecord(const Vertex &v) const {
     VERIFY(track_suffixes);
-    return data.find(&v)->second;
+    return record(v);
 }
 
 void RecordStorage::trackSuffixes(logging::Logger &logger, size_t threads) {
@@ -522,7 +517,7 @@ void RecordStorage::trackSuffixes(logging::Logger &logger, size_t threads) {
     track_suffixes = true;
     omp_set_num_threads(threads);
     std::function<void(Vertex &, const Sequence &)> vertex_task  = [this](Vertex &v, const Sequence &s) {
-        data.find(&v)->second.addPath(s);
+        record(v).addPath(s);
     };
     std::function<void(Segment<Edge>)> edge_task = [](Segment<Edge> seg){};
 #pragma omp parallel for default(none) shared(vertex_task, edge_task)
@@ -537,8 +532,8 @@ void RecordStorage::trackSuffixes(logging::Logger &logger, size_t threads) {
 void RecordStorage::untrackSuffixes() {
     if(track_suffixes) {
         track_suffixes = false;
-        for (auto &it: this->data) {
-            it.second.clear();
+        for (VertexRecord &rec: this->data) {
+            rec.clear();
         }
     }
 }
@@ -558,6 +553,54 @@ void RecordStorage::Load(std::istream &is, SparseDBG &dbg) {
     }
 }
 
+static const uint64_t reads_magic = 0x304e4c414a414cull; // "LJAALN0"
+static const uint64_t reads_version = 1;
+
+void RecordStorage::SaveBinary(std::ostream &os) const {
+    writeBinary<uint64_t>(os, size());
+    std::vector<uint64_t> buf;
+    for(const AlignedRead &alignedRead : *this) {
+        writeBinary<uint64_t>(os, alignedRead.id.size());
+        os.write(alignedRead.id.data(), alignedRead.id.size());
+        const dbg::CompactPath &cpath = alignedRead.path;
+        if(!cpath.valid()) {
+            writeBinary<uint64_t>(os, 0);
+            continue;
+        }
+        writeBinary<uint64_t>(os, 1);
+        writeBinary(os, cpath.start().hash());
+        writeBinary<uint64_t>(os, cpath.start().isCanonical());
+        writeBinary<uint64_t>(os, cpath.leftSkip());
+        writeBinary<uint64_t>(os, cpath.rightSkip());
+        writeBinary<uint64_t>(os, cpath.size());
+        buf.resize((cpath.size() + 31) / 32);
+        cpath.cpath().pack(buf.data());
+        os.write(reinterpret_cast<const char *>(buf.data()), buf.size() * sizeof(uint64_t));
+    }
+}
+
+void RecordStorage::LoadBinary(BinaryCursor &cursor, SparseDBG &dbg) {
+    size_t sz = cursor.read<uint64_t>();
+    reads.reserve(reads.size() + sz);
+    for(size_t i = 0; i < sz; i++) {
+        std::string id = cursor.readString(cursor.read<uint64_t>());
+        if(cursor.read<uint64_t>() == 0) {
+            addRead(AlignedRead(id, dbg::CompactPath()));
+            continue;
+        }
+        hashing::htype hash = cursor.read<hashing::htype>();
+        bool canonical = cursor.read<uint64_t>() != 0;
+        size_t left = cursor.read<uint64_t>();
+        size_t right = cursor.read<uint64_t>();
+        size_t len = cursor.read<uint64_t>();
+        const char *words = cursor.skip((len + 31) / 32 * sizeof(uint64_t));
+        Sequence edges = Sequence::fromPacked(len, [words, len](uint64_t *out) {
+            std::memcpy(out, words, (len + 31) / 32 * sizeof(uint64_t));
+        });
+        addRead(AlignedRead(id, dbg::CompactPath(dbg.getVertex(hash, canonical), edges, left, right)));
+    }
+}
+
 void SaveAllReads(const std::experimental::filesystem::path &fname, const std::vector<RecordStorage *> &recs) {
     std::ofstream os;
     os.open(fname);
@@ -566,10 +609,47 @@ void SaveAllReads(const std::experimental::filesystem::path &fname, const std::v
         rs->Save(os);
     }
     os.close();
+    std::experimental::filesystem::path bin = fname.string() + ".bin";
+    std::experimental::filesystem::path tmp = bin.string() + ".tmp";
+    std::ofstream bos;
+    bos.open(tmp, std::ios::binary);
+    writeBinary(bos, reads_magic);
+    writeBinary(bos, reads_version);
+    writeBinary<uint64_t>(bos, recs.size());
+    for(RecordStorage *rs : recs) {
+        rs->SaveBinary(bos);
+    }
+    writeBinary(bos, reads_magic);
+    bos.close();
+    VERIFY(!bos.fail());
+    std::experimental::filesystem::rename(tmp, bin);
+}
+
+static bool checkBinaryReads(const std::experimental::filesystem::path &fname, const MappedFile &file, size_t storages) {
+    if(!file.valid() || file.size() < 4 * sizeof(uint64_t))
+        return false;
+    if(std::experimental::filesystem::exists(fname) &&
+            std::experimental::filesystem::last_write_time(fname.string() + ".bin") < std::experimental::filesystem::last_write_time(fname))
+        return false;
+    BinaryCursor cursor(file.data(), file.size());
+    BinaryCursor tail(file.data() + file.size() - sizeof(uint64_t), sizeof(uint64_t));
+    return cursor.read<uint64_t>() == reads_magic && cursor.read<uint64_t>() == reads_version &&
+            cursor.read<uint64_t>() == storages && tail.read<uint64_t>() == reads_magic;
 }
 
 void LoadAllReads(const std::experimental::filesystem::path &fname, const std::vector<RecordStorage *> &recs,
                   dbg::SparseDBG &dbg) {
+    MappedFile file(fname.string() + ".bin");
+    if(checkBinaryReads(fname, file, recs.size())) {
+        file.adviseSequential();
+        BinaryCursor cursor(file.data(), file.size());
+        cursor.skip(3 * sizeof(uint64_t));
+        for(RecordStorage *recordStorage : recs) {
+            recordStorage->LoadBinary(cursor, dbg);
+        }
+        VERIFY(cursor.read<uint64_t>() == reads_magic);
+        return;
+    }
     std::ifstream is;
     is.open(fname);
     size_t sz;
@@ -579,4 +659,4 @@ void LoadAllReads(const std::experimental::filesystem::path &fname, const std::v
         recordStorage->Load(is, dbg);
     }
     is.close();
-}
\ No newline at end of file
+}
@@ -1,20 +1,24 @@
 #pragma once
 
 #include "compact_path.hpp"
+#include "path_trie.hpp"
+#include "frozen_graph.hpp"
+#include "read_id.hpp"
+#include "common/mmap_utils.hpp"
 
 class AlignedRead {
 private:
     dbg::CompactPath corrected_path;
 public:
-    std::string id;
+    ReadId id;
     dbg::CompactPath path;
 
     AlignedRead() = default;
     AlignedRead(AlignedRead &&other) = default;
     AlignedRead &operator=(AlignedRead &&other) = default;
-    explicit AlignedRead(std::string readId) : id(std::move(readId)) {}
-    AlignedRead(std::string readId, dbg::GraphAlignment &_path) : id(std::move(readId)), path(_path) {}
-    AlignedRead(std::string readId, dbg::CompactPath _path) : id(std::move(readId)), path(std::move(_path)) {}
+    explicit AlignedRead(ReadId readId) : id(readId) {}
+    AlignedRead(ReadId readId, dbg::GraphAlignment &_path) : id(readId), path(_path) {}
+    AlignedRead(ReadId readId, dbg::CompactPath _path) : id(readId), path(std::move(_path)) {}
 
     bool operator<(const AlignedRead& other) const {return id < other.id;}
 
@@ -40,11 +44,8 @@ class RecordStorage;
 struct VertexRecord {
     friend RecordStorage;
 private:
-    typedef std::vector<std::pair<Sequence, size_t>> Storage;
-    typedef Storage::const_iterator const_iterator;
     dbg::Vertex &v;
-    Storage paths;
-    size_t zero_cnt = 0;
+    dbg::PathTrie paths;
     size_t cov = 0;
 
     void lock() const {v.lock();}
@@ -56,15 +57,15 @@ private:
 public:
     explicit VertexRecord(dbg::Vertex &_v) : v(_v) {}
     VertexRecord(const VertexRecord &) = delete;
-    VertexRecord(VertexRecord &&other)  noexcept : v(other.v), paths(std::move(other.paths)),
-                                                   zero_cnt(other.zero_cnt), cov(other.cov) {}
+    VertexRecord(VertexRecord &&other)  noexcept : v(other.v), paths(std::move(other.paths)), cov(other.cov) {}
 
     VertexRecord & operator=(const VertexRecord &) = delete;
 
     size_t coverage() const {return cov;}
     std::string str() const;
-    const_iterator begin() const {return paths.begin();}
-    const_iterator end() const {return paths.end();}
+//    Calls f(path, count) for every distinct read subpath that starts at this vertex
+    template<class F>
+    void forEachPath(const F &f) const {paths.forEach(f);}
 
     size_t countStartsWith(const Sequence &seq) const;
 
@@ -124,8 +125,15 @@ public:
 
 class RecordStorage {
 private:
+    static constexpr uint32_t NO_RECORD = uint32_t(-1);
+
     std::vector<AlignedRead> reads;
-    std::unordered_map<const dbg::Vertex *, VertexRecord> data;
+//    Records of all vertices of the graph and an open addressing index over them that stores positions of records in
+//    data. The set of vertices is fixed when the storage is created so the index is never modified afterwards and
+//    threads look records up without synchronization. Changes of a record are guarded by the lock of its vertex.
+    std::vector<VertexRecord> data;
+    std::vector<uint32_t> index;
+    size_t index_shift = 63;
     ReadLogger *readLogger;
 public:
     size_t min_len;
@@ -135,8 +143,19 @@ public:
     bool log_changes;
 
 private:
+    size_t slot(const dbg::Vertex *v) const {
+        return size_t((uint64_t(reinterpret_cast<uintptr_t>(v)) * 0x9E3779B97F4A7C15ull) >> index_shift);
+    }
+
+    size_t recordIndex(const dbg::Vertex &v) const;
+    VertexRecord &record(const dbg::Vertex &v);
+    const VertexRecord &record(const dbg::Vertex &v) const;
     void processPath(const dbg::CompactPath &cpath, const std::function<void(dbg::Vertex &, const Sequence &)> &task,
                             const std::function<void(Segment<dbg::Edge>)> &edge_task = [](Segment<dbg::Edge>){}) const;
+//    Aligner is anything with GraphAlignment align(const Sequence &) const
+    template<class I, class Aligner>
+    void fill(I begin, I end, dbg::SparseDBG &dbg, const Aligner &aligner, size_t min_read_size,
+              logging::Logger &logger, size_t threads);
 public:
     RecordStorage(dbg::SparseDBG &dbg, size_t _min_len, size_t _max_len, size_t threads,
                   ReadLogger &readLogger, bool _track_cov = false, bool log_changes = false, bool track_suffixes = true);
@@ -178,6 +197,10 @@ public:
 
     template<class I>
     void fill(I begin, I end, dbg::SparseDBG &dbg, size_t min_read_size, logging::Logger &logger, size_t threads);
+//    Same as above but aligns reads to a frozen copy of the graph. Worth it when one copy serves several fills.
+    template<class I>
+    void fill(I begin, I end, const dbg::FrozenGraph &frozen, size_t min_read_size, logging::Logger &logger,
+              size_t threads);
     void trackSuffixes(logging::Logger &logger, size_t threads);
     void untrackSuffixes();
 
@@ -192,47 +215,65 @@ public:
     void Save(std::ostream &os) const;
 
     void Load(std::istream &is, dbg::SparseDBG &dbg);
+
+//    Same content as Save/Load in binary form with read paths packed 2 bits per edge
+    void SaveBinary(std::ostream &os) const;
+
+    void LoadBinary(BinaryCursor &cursor, dbg::SparseDBG &dbg);
 };
 
+//Writes reads to fname in text form and to fname.bin in binary form. LoadAllReads uses the binary file if it is
+//complete and not older than the text one.
 void SaveAllReads(const std::experimental::filesystem::path &fname, const std::vector<RecordStorage *> &recs);
 
 void LoadAllReads(const std::experimental::filesystem::path &fname, const std::vector<RecordStorage *> &recs, dbg::SparseDBG &dbg);
 
 template<class I>
 void RecordStorage::fill(I begin, I end, dbg::SparseDBG &dbg, size_t min_read_size, logging::Logger &logger, size_t threads) {
+    fill(begin, end, dbg, dbg::GraphAligner(dbg), min_read_size, logger, threads);
+}
+
+template<class I>
+void RecordStorage::fill(I begin, I end, const dbg::FrozenGraph &frozen, size_t min_read_size, logging::Logger &logger,
+                         size_t threads) {
+    fill(begin, end, frozen.graph(), frozen, min_read_size, logger, threads);
+}
+
+template<class I, class Aligner>
+void RecordStorage::fill(I begin, I end, dbg::SparseDBG &dbg, const Aligner &aligner, size_t min_read_size,
+                         logging::Logger &logger, size_t threads) {
     if (track_cov) {
         logger.info() << "Cleaning edge coverages" << std::endl;
         for(dbg::Edge & edge: dbg.edges()) {
             edge.incCov(-edge.intCov());
         }
     }
+    logging::StageTimer timer("RecordStorage::fill");
     logger.info() << "Collecting alignments of sequences to the graph" << std::endl;
     if(track_suffixes) {
         logger.info() << "Storing suffixes of read paths of length up to " << this->max_len << std::endl;
     }
-    ParallelRecordCollector<std::tuple<size_t, std::string, dbg::CompactPath>> tmpReads(threads);
+//    Reads are written straight to the slot of their input position so no copy of all reads is kept
+    ParallelSlotArray<AlignedRead> slots;
     ParallelCounter cnt(threads);
-    std::function<void(size_t, StringContig &)> read_task = [this, min_read_size, &tmpReads, &cnt, &dbg](size_t pos, StringContig & scontig) {
+    typedef typename I::value_type ContigType;
+    std::function<void(size_t, ContigType &)> read_task = [this, min_read_size, &slots, &cnt, &aligner](size_t pos, ContigType & scontig) {
         Contig contig = scontig.makeContig();
         if(contig.size() < min_read_size) {
-            tmpReads.emplace_back(pos, contig.id, dbg::CompactPath());
+            slots[pos] = AlignedRead(contig.id);
             return;
         }
-        dbg::GraphAlignment path = dbg::GraphAligner(dbg).align(contig.seq);
+        dbg::GraphAlignment path = aligner.align(contig.seq);
         dbg::CompactPath cpath(path);
         dbg::GraphAlignment rcPath = path.RC();
         dbg::CompactPath crcPath(rcPath);
         addSubpath(cpath);
         addSubpath(crcPath);
         cnt += cpath.size();
-        tmpReads.emplace_back(pos, contig.id, cpath);
+        slots[pos] = AlignedRead(contig.id, std::move(cpath));
     };
     processRecords(begin, end, logger, threads, read_task);
-    reads.resize(tmpReads.size());
-    for(auto &rec : tmpReads) {
-        VERIFY(std::get<0>(rec) < reads.size());
-        reads[std::get<0>(rec)] = AlignedRead(std::get<1>(rec), std::move(std::get<2>(rec)));
-    }
+    reads = slots.collect();
     logger.info() << "Alignment collection finished. Total length of alignments is " << cnt.get() << std::endl;
 }
 
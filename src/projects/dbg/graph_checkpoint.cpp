@@ -0,0 +1,202 @@
+#include "graph_checkpoint.hpp"
+#include <cstdio>
+#include <fstream>
+
+using namespace dbg;
+
+constexpr uint64_t DBGCheckpoint::magic;
+constexpr uint64_t DBGCheckpoint::version;
+
+static size_t wordNum(size_t nucls) {
+    return (nucls + 31) / 32;
+}
+
+static Sequence copyPacked(const uint64_t *words, size_t size) {
+    return Sequence::fromPacked(size, [words, size](uint64_t *out) {
+        std::copy(words, words + wordNum(size), out);
+    });
+}
+
+void DBGCheckpoint::Save(const std::experimental::filesystem::path &fname, SparseDBG &dbg, size_t w, uint64_t inputs) {
+    size_t k = dbg.hasher().getK();
+    std::vector<Vertex *> vertices;
+    std::unordered_map<hashing::htype, uint64_t, hashing::alt_hasher<hashing::htype>> index;
+    for(auto &it : dbg) {
+        index[it.first] = vertices.size();
+        vertices.push_back(&it.second);
+    }
+    std::function<uint64_t(const Vertex &)> vid = [&index](const Vertex &vertex) -> uint64_t {
+        return index.find(vertex.hash())->second * 2 + (vertex.isCanonical() ? 0 : 1);
+    };
+    std::vector<VertexRecord> vrecs;
+    std::vector<EdgeRecord> erecs;
+    std::unordered_map<const Edge *, uint64_t> edge_ids;
+    uint64_t words = 0;
+    for(Vertex *vertex : vertices) {
+        VERIFY(vertex->seq.empty() || vertex->seq.size() == k);
+        vrecs.push_back({vertex->hash(), vertex->coverage_, vertex->seq.empty() ? uint64_t(-1) : words});
+        if(!vertex->seq.empty())
+            words += wordNum(k);
+    }
+    for(size_t id = 0; id < vertices.size() * 2; id++) {
+        Vertex &vertex = id % 2 == 0 ? *vertices[id / 2] : vertices[id / 2]->rc();
+        for(Edge &edge : vertex) {
+            if(!dbg.anchors.empty())
+                edge_ids[&edge] = erecs.size();
+            erecs.push_back({id, edge.end() == nullptr ? uint64_t(-1) : vid(*edge.end()), edge.size(), edge.intCov(),
+                             words, edge.is_reliable});
+            words += wordNum(edge.size());
+        }
+    }
+    std::vector<AnchorRecord> arecs;
+    for(auto &it : dbg.anchors) {
+        arecs.push_back({it.first, edge_ids.find(it.second.edge)->second, it.second.pos});
+    }
+    edge_ids.clear();
+
+    std::experimental::filesystem::path tmp = fname.string() + ".tmp";
+    std::ofstream os;
+    os.open(tmp, std::ios::binary);
+    Header header = {magic, version, dbg.hasher().getBase(), k, w, inputs, dbg.hasPerfectVertexIndex() ? 1u : 0u,
+                     vrecs.size(), erecs.size(), arecs.size(), words};
+    writeBinary(os, header);
+    os.write(reinterpret_cast<const char *>(vrecs.data()), vrecs.size() * sizeof(VertexRecord));
+    os.write(reinterpret_cast<const char *>(erecs.data()), erecs.size() * sizeof(EdgeRecord));
+    os.write(reinterpret_cast<const char *>(arecs.data()), arecs.size() * sizeof(AnchorRecord));
+    std::vector<uint64_t> buf;
+    for(Vertex *vertex : vertices) {
+        if(vertex->seq.empty())
+            continue;
+        buf.resize(wordNum(k));
+        vertex->seq.pack(buf.data());
+        os.write(reinterpret_cast<const char *>(buf.data()), buf.size() * sizeof(uint64_t));
+    }
+    for(size_t id = 0; id < vertices.size() * 2; id++) {
+        Vertex &vertex = id % 2 == 0 ? *vertices[id / 2] : vertices[id / 2]->rc();
+        for(Edge &edge : vertex) {
+            buf.resize(wordNum(edge.size()));
+            edge.seq.pack(buf.data());
+            os.write(reinterpret_cast<const char *>(buf.data()), buf.size() * sizeof(uint64_t));
+        }
+    }
+    os.close();
+    VERIFY(!os.fail());
+    std::experimental::filesystem::rename(tmp, fname);
+}
+
+bool DBGCheckpoint::readHeader(const MappedFile &file, DBGCheckpoint::Header &header) {
+    if(!file.valid() || file.size() < sizeof(Header))
+        return false;
+    header = BinaryCursor(file.data(), file.size()).read<Header>();
+    if(header.magic != magic || header.version != version)
+        return false;
+    size_t expected = sizeof(Header) + header.vertex_num * sizeof(VertexRecord) + header.edge_num * sizeof(EdgeRecord) +
+            header.anchor_num * sizeof(AnchorRecord) + header.word_num * sizeof(uint64_t);
+    return expected == file.size();
+}
+
+bool DBGCheckpoint::Check(const std::experimental::filesystem::path &fname, const hashing::RollingHash &hasher,
+                          size_t w, uint64_t inputs) {
+    if(!std::experimental::filesystem::is_regular_file(fname))
+        return false;
+    MappedFile file(fname);
+    Header header = {};
+    return readHeader(file, header) && header.k == hasher.getK() && header.base == hasher.getBase() &&
+            header.w == w && header.inputs == inputs;
+}
+
+uint64_t DBGCheckpoint::Fingerprint(const std::vector<std::experimental::filesystem::path> &files) {
+    uint64_t res = 0;
+    for(const std::experimental::filesystem::path &fname : files) {
+        std::error_code ec;
+        uint64_t size = std::experimental::filesystem::file_size(fname, ec);
+        if(ec)
+            size = uint64_t(-1);
+        auto time = std::experimental::filesystem::last_write_time(fname, ec);
+        uint64_t mtime = ec ? uint64_t(-1) : uint64_t(time.time_since_epoch().count());
+        for(uint64_t val : {size, mtime})
+            res = (res ^ val) * 0x100000001b3ull + 0x9e3779b97f4a7c15ull;
+    }
+    return res;
+}
+
+SparseDBG DBGCheckpoint::Load(const std::experimental::filesystem::path &fname, const hashing::RollingHash &hasher,
+                              logging::Logger &logger, size_t threads, bool restore_coverage) {
+    logger.info() << "Loading graph from binary checkpoint " << fname << std::endl;
+    MappedFile file(fname);
+    Header header = {};
+    VERIFY(readHeader(file, header));
+    VERIFY(header.k == hasher.getK() && header.base == hasher.getBase());
+    size_t k = header.k;
+    BinaryCursor cursor(file.data(), file.size());
+    cursor.skip(sizeof(Header));
+//    Mapping is page aligned and all sections have sizes divisible by htype alignment so records are used in place
+    const auto *vrecs = reinterpret_cast<const VertexRecord *>(cursor.skip(header.vertex_num * sizeof(VertexRecord)));
+    const auto *erecs = reinterpret_cast<const EdgeRecord *>(cursor.skip(header.edge_num * sizeof(EdgeRecord)));
+    const auto *arecs = reinterpret_cast<const AnchorRecord *>(cursor.skip(header.anchor_num * sizeof(AnchorRecord)));
+    const uint64_t *words = reinterpret_cast<const uint64_t *>(cursor.skip(header.word_num * sizeof(uint64_t)));
+
+    std::vector<hashing::htype> hashes(header.vertex_num);
+    for(size_t i = 0; i < hashes.size(); i++) {
+        hashes[i] = vrecs[i].hash;
+    }
+    SparseDBG res = header.perfect_vertex_index != 0 ? SparseDBG(hashes, hasher, threads) :
+                    SparseDBG(hashes.begin(), hashes.end(), hasher);
+    hashes.clear();
+    hashes.shrink_to_fit();
+    size_t vertex_num = header.vertex_num;
+    std::vector<Vertex *> vertices(vertex_num * 2);
+    std::vector<size_t> edge_begin(vertices.size() + 1, 0);
+    for(size_t i = 0; i < header.edge_num; i++) {
+        const EdgeRecord &rec = erecs[i];
+        VERIFY(rec.start < vertices.size() && (i == 0 || erecs[i - 1].start <= rec.start));
+        edge_begin[rec.start + 1]++;
+    }
+    for(size_t i = 0; i < vertices.size(); i++) {
+        edge_begin[i + 1] += edge_begin[i];
+    }
+    omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(vrecs, vertex_num, vertices, res, words, k, restore_coverage)
+    for(size_t i = 0; i < vertex_num; i++) {
+        Vertex &vertex = res.getVertex(vrecs[i].hash);
+        vertices[i * 2] = &vertex;
+        vertices[i * 2 + 1] = &vertex.rc();
+        if(vrecs[i].seq_offset != uint64_t(-1)) {
+            vertex.seq = copyPacked(words + vrecs[i].seq_offset, k);
+            vertex.rc().seq = !vertex.seq;
+        }
+        if(restore_coverage) {
+            vertex.coverage_ = vrecs[i].coverage;
+            vertex.rc().coverage_ = vrecs[i].coverage;
+        }
+    }
+    if(vertex_num > 0) {
+        const Vertex &check = *vertices[0];
+        VERIFY(check.seq.empty() || hashing::KWH(hasher, check.seq, 0).hash() == check.hash());
+    }
+#pragma omp parallel for default(none) shared(vertices, erecs, edge_begin, words, restore_coverage) schedule(dynamic, 1024)
+    for(size_t id = 0; id < vertices.size(); id++) {
+        Vertex &vertex = *vertices[id];
+        vertex.outgoing_.reserve(edge_begin[id + 1] - edge_begin[id]);
+        for(size_t i = edge_begin[id]; i < edge_begin[id + 1]; i++) {
+            const EdgeRecord &rec = erecs[i];
+            Vertex *end = rec.end == uint64_t(-1) ? nullptr : vertices[rec.end];
+            vertex.outgoing_.emplace_back(&vertex, end, copyPacked(words + rec.seq_offset, rec.size));
+            Edge &edge = vertex.outgoing_.back();
+            edge.is_reliable = rec.reliable != 0;
+            if(restore_coverage)
+                edge.incCov(rec.cov);
+        }
+    }
+    std::vector<SparseDBG::anchor_map_type::value_type> anchors;
+    anchors.reserve(header.anchor_num);
+    for(size_t i = 0; i < header.anchor_num; i++) {
+        const AnchorRecord &rec = arecs[i];
+        const EdgeRecord &erec = erecs[rec.edge];
+        Edge &edge = vertices[erec.start]->outgoing_[rec.edge - edge_begin[erec.start]];
+        anchors.emplace_back(rec.hash, EdgePosition(edge, rec.pos));
+    }
+    res.anchors.insert(std::move(anchors), threads);
+    logger.info() << "Loaded graph with " << vertices.size() << " vertices and " << header.edge_num << " edges" << std::endl;
+    return std::move(res);
+}
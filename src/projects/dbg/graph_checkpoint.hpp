@@ -0,0 +1,73 @@
+#pragma once
+#include "sparse_dbg.hpp"
+#include "common/mmap_utils.hpp"
+#include <experimental/filesystem>
+#include <cstdint>
+
+namespace dbg {
+/*
+ * Versioned binary snapshot of SparseDBG: vertices with coverage and sequence, all edges with coverage and
+ * reliability flag, and anchors. Sequences are stored 2 bits per nucleotide, each starting at a word boundary, so
+ * loading a graph is a memory copy per sequence with no parsing. The file is memory mapped on load and records are
+ * read in place, so all sections are aligned to hashing::htype.
+ * Header stores the hasher, the window size and a fingerprint of the files the graph was built from so that a
+ * checkpoint of different inputs is never reused. It also stores whether vertices were indexed by a perfect hash so
+ * that the loaded graph uses the same vertex store. Edge ids (Edge::id) are not stored.
+ * Layout: Header, VertexRecord[vertex_num], EdgeRecord[edge_num], AnchorRecord[anchor_num], uint64_t[word_num].
+ * Vertex i of the file is the canonical vertex, its rc has id 2 * i + 1, edges are sorted by start vertex id.
+ */
+    class DBGCheckpoint {
+    public:
+        static constexpr uint64_t magic = 0x30474244414a4cull; // "LJADBG0"
+        static constexpr uint64_t version = 2;
+    private:
+        struct Header {
+            uint64_t magic;
+            uint64_t version;
+            hashing::htype base;
+            uint64_t k;
+            uint64_t w;
+            uint64_t inputs;
+            uint64_t perfect_vertex_index;
+            uint64_t vertex_num;
+            uint64_t edge_num;
+            uint64_t anchor_num;
+            uint64_t word_num;
+        };
+        struct VertexRecord {
+            hashing::htype hash;
+            uint64_t coverage;
+            uint64_t seq_offset;
+        };
+        struct EdgeRecord {
+            uint64_t start;
+            uint64_t end;
+            uint64_t size;
+            uint64_t cov;
+            uint64_t seq_offset;
+            uint64_t reliable;
+        };
+        struct AnchorRecord {
+            hashing::htype hash;
+            uint64_t edge;
+            uint64_t pos;
+        };
+        static_assert(sizeof(Header) % alignof(hashing::htype) == 0 &&
+                      sizeof(VertexRecord) % alignof(hashing::htype) == 0 &&
+                      sizeof(EdgeRecord) % alignof(hashing::htype) == 0 &&
+                      sizeof(AnchorRecord) % alignof(hashing::htype) == 0, "Checkpoint sections must stay aligned");
+        static bool readHeader(const MappedFile &file, Header &header);
+    public:
+//        w and inputs are only compared by Check. Graphs that are not built from files are saved with zero inputs.
+        static void Save(const std::experimental::filesystem::path &fname, SparseDBG &dbg, size_t w = 0,
+                         uint64_t inputs = 0);
+//        Returns true if fname is a complete checkpoint of a graph with the same hasher, window size and inputs
+        static bool Check(const std::experimental::filesystem::path &fname, const hashing::RollingHash &hasher,
+                          size_t w = 0, uint64_t inputs = 0);
+//        Fingerprint of input files made of their sizes and modification times. Missing files also change it.
+        static uint64_t Fingerprint(const std::vector<std::experimental::filesystem::path> &files);
+//        If restore_coverage is false edge and vertex coverages are left zero
+        static SparseDBG Load(const std::experimental::filesystem::path &fname, const hashing::RollingHash &hasher,
+                              logging::Logger &logger, size_t threads, bool restore_coverage = true);
+    };
+}
@@ -45,9 +45,11 @@ GraphAlignment realignRead(const GraphAlignment &al,
     return new_al;
 }
 
-void RemoveUncovered(logging::Logger &logger, size_t threads, SparseDBG &dbg, const std::vector<RecordStorage *> &storages,
-                size_t new_extension_size) {
-    logger.info() << "Applying changes to the graph" << std::endl;
+//Collects maximal edge segments covered by reads from all storages. Segments are sorted and given for one edge of each
+//rc pair. Edges next to unbranching vertices and long well covered edges are kept entirely. Also finds the length of the
+//shortest aligned read which is used as anchor density. Leaves extraInfo of all edges equal to 0.
+static std::vector<Segment<Edge>> CoveredSegments(logging::Logger &logger, size_t threads, SparseDBG &dbg,
+                                                  const std::vector<RecordStorage *> &storages, size_t &min_len) {
     omp_set_num_threads(threads);
     logger.trace() << "Collecting covered edge segments" << std::endl;
     size_t k = dbg.hasher().getK();
@@ -90,7 +92,7 @@ void RemoveUncovered(logging::Logger &logger, size_t threads, SparseDBG &dbg, co
         }
         edge.extraInfo = 0;
     }
-    size_t min_len = 100000;
+    min_len = 100000;
     for(size_t len : lenStorage) {
         min_len = std::min(min_len, len);
     }
@@ -111,6 +113,14 @@ void RemoveUncovered(logging::Logger &logger, size_t threads, SparseDBG &dbg, co
         }
     }
     logger.trace() << "Extracted " << segs.size() << " covered segments" << std::endl;
+    return std::move(segs);
+}
+
+void RemoveUncovered(logging::Logger &logger, size_t threads, SparseDBG &dbg, const std::vector<RecordStorage *> &storages,
+                size_t new_extension_size) {
+    logger.info() << "Applying changes to the graph" << std::endl;
+    size_t min_len = 0;
+    std::vector<Segment<Edge>> segs = CoveredSegments(logger, threads, dbg, storages, min_len);
     logger.trace() << "Constructing subgraph" << std::endl;
     SparseDBG subgraph = dbg.Subgraph(segs);
     subgraph.checkConsistency(threads, logger);
@@ -174,6 +184,171 @@ void RemoveUncovered(logging::Logger &logger, size_t threads, SparseDBG &dbg, co
     dbg = std::move(subgraph);
 }
 
+//Covered part of a changed edge. Ends that are not old vertices are created from k-mers when the piece is added.
+struct CoveredPiece {
+    Vertex *left;
+    Vertex *right;
+    Sequence left_kmer;
+    Sequence right_kmer;
+    bool self_rc;
+    Sequence seq;
+    Sequence rc_seq;
+
+    explicit CoveredPiece(const Segment<Edge> &seg) : left(nullptr), right(nullptr), self_rc(false) {
+        Segment<Edge> rcSeg = seg.RC();
+        if(seg.left == 0)
+            left = seg.contig().start();
+        else
+            left_kmer = seg.contig().kmerSeq(seg.left);
+        if(rcSeg.left == 0)
+            right = rcSeg.contig().start();
+        else if(seg == rcSeg)
+            self_rc = true;
+        else
+            right_kmer = rcSeg.contig().kmerSeq(rcSeg.left);
+        seq = seg.seq();
+        rc_seq = rcSeg.seq();
+    }
+
+    void add(SparseDBG &dbg) {
+        if(left == nullptr)
+            left = &dbg.addVertex(left_kmer);
+        if(self_rc)
+            right = left;
+        else if(right == nullptr)
+            right = &dbg.addVertex(right_kmer);
+        left->addEdge(Edge(left, &right->rc(), seq));
+        right->addEdge(Edge(right, &left->rc(), rc_seq));
+    }
+};
+
+//Stores sequences of valid reads that pass through edges or vertices selected by the predicate. These reads are aligned
+//to the graph again after it is changed. Paths of all other reads stay valid.
+static void SaveChangedReads(RecordStorage &storage, std::vector<Sequence> &seqs,
+                             const std::function<bool(const GraphAlignment &)> &changed) {
+#pragma omp parallel for default(none) schedule(dynamic, 100) shared(storage, seqs, changed)
+    for(size_t i = 0; i < storage.size(); i++) {
+        AlignedRead &alignedRead = storage[i];
+        if(!alignedRead.valid() || !seqs[i].empty())
+            continue;
+        GraphAlignment al = alignedRead.path.getAlignment();
+        if(changed(al))
+            seqs[i] = al.Seq();
+    }
+}
+
+void PruneUncovered(logging::Logger &logger, size_t threads, SparseDBG &dbg, const std::vector<RecordStorage *> &storages,
+                    size_t new_extension_size) {
+    logger.info() << "Applying changes to the graph in place" << std::endl;
+    size_t min_len = 0;
+    std::vector<Segment<Edge>> segs = CoveredSegments(logger, threads, dbg, storages, min_len);
+    logger.trace() << "Finding changed edges" << std::endl;
+    for(size_t i = 0; i < segs.size(); i++) {
+        Edge &edge = segs[i].contig();
+        if((i > 0 && segs[i - 1].contig() == edge) || (i + 1 < segs.size() && segs[i + 1].contig() == edge))
+            continue;
+        if(segs[i].left == 0 && segs[i].right == edge.size()) {
+            edge.extraInfo = 1;
+            edge.rc().extraInfo = 1;
+        }
+    }
+    std::vector<CoveredPiece> pieces;
+    for(Segment<Edge> &seg : segs) {
+        if(seg.contig().extraInfo != 1)
+            pieces.emplace_back(seg);
+    }
+    segs = {};
+    std::vector<std::pair<Vertex *, unsigned char>> removed;
+    std::vector<Vertex *> touched;
+    for(Edge &edge : dbg.edges()) {
+        if(edge < edge.rc() || edge.extraInfo == 1)
+            continue;
+        removed.emplace_back(edge.start(), edge.seq[0]);
+        if(edge.rc() != edge)
+            removed.emplace_back(edge.rc().start(), edge.rc().seq[0]);
+        touched.emplace_back(edge.start());
+        touched.emplace_back(edge.end());
+    }
+    logger.trace() << "Replacing " << removed.size() << " edges with " << pieces.size() << " covered pieces" << std::endl;
+    omp_set_num_threads(threads);
+    std::vector<std::vector<Sequence>> changed_reads;
+    std::vector<bool> track_suffixes;
+    for(RecordStorage *sit : storages) {
+        track_suffixes.push_back(sit->isTrackingSuffixes());
+        sit->untrackSuffixes();
+        changed_reads.emplace_back(sit->size());
+        SaveChangedReads(*sit, changed_reads.back(), [](const GraphAlignment &al) {
+            for(const Segment<Edge> &seg : al) {
+                if(seg.contig().extraInfo != 1)
+                    return true;
+            }
+            return false;
+        });
+    }
+    for(std::pair<Vertex *, unsigned char> &edge_id : removed) {
+        edge_id.first->removeOutgoing(edge_id.second);
+    }
+    for(CoveredPiece &piece : pieces) {
+        piece.add(dbg);
+        touched.emplace_back(piece.left);
+        touched.emplace_back(piece.right);
+    }
+    pieces = {};
+    dbg.checkConsistency(threads, logger);
+//    Paths through vertices that became unbranching change when these vertices are merged.
+    for(size_t i = 0; i < storages.size(); i++) {
+        SaveChangedReads(*storages[i], changed_reads[i], [](const GraphAlignment &al) {
+            for(size_t j = 0; j <= al.size(); j++) {
+                if(!al.getVertex(j).isJunction())
+                    return true;
+            }
+            return false;
+        });
+    }
+    std::unordered_set<hashing::htype, hashing::alt_hasher<hashing::htype>> anchors;
+    for(const auto & vit : dbg){
+        if(vit.second.inDeg() == 1 && vit.second.outDeg() == 1) {
+            anchors.emplace(vit.first);
+        }
+    }
+    mergeAll(logger, dbg, threads, std::move(touched));
+    printStats(logger, dbg);
+    dbg.clearAnchors();
+    dbg.fillAnchors(min_len, logger, threads, anchors);
+    for(Edge &edge : dbg.edges()) {
+        edge.incCov(size_t(-edge.intCov()));
+        edge.extraInfo = size_t(-1);
+        edge.is_reliable = false;
+    }
+
+    logger.trace() << "Realigning reads" << std::endl;
+    for(size_t sind = 0; sind < storages.size(); sind++) {
+        RecordStorage &storage = *storages[sind];
+        std::vector<Sequence> &seqs = changed_reads[sind];
+        if(new_extension_size == 0)
+            new_extension_size = storage.getMaxLen();
+        RecordStorage new_storage(dbg, storage.getMinLen(), new_extension_size, threads, storage.getLogger(),
+                                  storage.isTrackingCov(), false, track_suffixes[sind]);
+        for(AlignedRead &al : storage) {
+            new_storage.addRead(AlignedRead(al.id));
+        }
+#pragma omp parallel for default(none) schedule(dynamic, 100) shared(storage, new_storage, seqs, dbg)
+        for(size_t i = 0; i < storage.size(); i++) {
+            AlignedRead &alignedRead = storage[i];
+            if(!alignedRead.valid()) {
+                continue;
+            }
+            GraphAlignment al = seqs[i].empty() ? alignedRead.path.getAlignment() : GraphAligner(dbg).align(seqs[i]);
+            seqs[i] = {};
+            new_storage.reroute(new_storage[i], al, "Remapping");
+            new_storage.apply(new_storage[i]);
+            alignedRead.invalidate();
+        }
+        new_storage.log_changes = storage.log_changes;
+        storage = std::move(new_storage);
+    }
+}
+
 void AddConnections(logging::Logger &logger, size_t threads, SparseDBG &dbg, const std::vector<RecordStorage *> &storages,
                const std::vector<Connection> &connections) {
     logger.info() << "Adding new connections to the graph" << std::endl;
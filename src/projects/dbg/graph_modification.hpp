@@ -7,6 +7,11 @@
 void RemoveUncovered(logging::Logger &logger, size_t threads, dbg::SparseDBG &dbg,
                             const std::vector<RecordStorage*> &storages, size_t new_extension_size = 0);
 
+//Same as RemoveUncovered but changes the graph in place. Only edges that are not fully covered are replaced with their
+//covered pieces, only paths around them are merged and only reads that pass through changed parts are realigned.
+void PruneUncovered(logging::Logger &logger, size_t threads, dbg::SparseDBG &dbg,
+                    const std::vector<RecordStorage*> &storages, size_t new_extension_size = 0);
+
 class Connection {
 public:
     dbg::EdgePosition pos1;
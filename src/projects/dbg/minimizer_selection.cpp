@@ -11,21 +11,22 @@ using namespace hashing;
  * @param threads 线程数
  * @param hasher 哈希器
  * @param w 窗口大小
+ * @param min_count 保留的最小化器至少需要出现的次数
  *
  * @return 最小化器列表
  */
 std::vector<htype>
 constructMinimizers(logging::Logger &logger, const io::Library &reads_file, size_t threads, const RollingHash &hasher,
-                    const size_t w) {
+                    const size_t w, size_t min_count) {
     logger.info() << "Reading reads" << std::endl;
     std::vector<std::vector<htype>> prev;
     prev.resize(threads);
     const size_t buffer_size = 1000000000;
     logger.info() << "Extracting minimizers" << std::endl;
     size_t min_read_size = hasher.getK() + w - 1;
-    ParallelRecordCollector<htype> hashs(threads);
+    ParallelUniqueCounter<htype, alt_hasher<htype>> hashs(threads);
     //初始化为多线程任务
-    std::function<void(size_t, StringContig &)> task = [min_read_size, w, &hasher, &hashs](size_t pos, StringContig & contig) {
+    auto task = [min_read_size, w, &hasher, &hashs](size_t pos, auto & contig) {
         Sequence seq = contig.makeSequence();
         if(seq.size() >= min_read_size) {
             MinimizerCalculator calc(seq, hasher, w);
@@ -38,15 +39,20 @@ constructMinimizers(logging::Logger &logger, const io::Library &reads_file, size
             hashs.addAll(minimizers.begin(), minimizers.end());
         }
     };
-    io::SeqReader reader(reads_file, (hasher.getK() + w) * 20, (hasher.getK() + w) * 4);
-    processRecords(reader.begin(), reader.end(), logger, threads, task);
+    io::ReadLibrary(reads_file, [&logger, threads, &task](auto begin, auto end) {
+        processRecords(begin, end, logger, threads, task);
+    }, (hasher.getK() + w) * 20, (hasher.getK() + w) * 4);
 
+    hashs.flushAll();
     logger.info() << "Finished read processing" << std::endl;
-    logger.info() << hashs.size() << " hashs collected. Starting sorting." << std::endl;
-    std::vector<htype> hash_list = hashs.collectUnique();
-    //    TODO replace with parallel std::sort
-//    __gnu_parallel::sort(hash_list.begin(), hash_list.end());
-//    hash_list.erase(std::unique(hash_list.begin(), hash_list.end()), hash_list.end());
+    std::vector<size_t> shard_sizes = hashs.shardSizes();
+    std::vector<size_t> hist = hashs.histogram(2);
+    logger.info() << hashs.size() << " distinct hashs collected in " << shard_sizes.size() << " shards. Shard sizes range from "
+                  << *std::min_element(shard_sizes.begin(), shard_sizes.end()) << " to "
+                  << *std::max_element(shard_sizes.begin(), shard_sizes.end()) << ". " << hist[1]
+                  << " hashs occurred only once." << std::endl;
+    logger.info() << "Starting sorting." << std::endl;
+    std::vector<htype> hash_list = hashs.collectSorted(min_count);
     logger.info() << "Finished sorting. Total distinct minimizers: " << hash_list.size() << std::endl;
     if (hash_list.size() == 0) {
         logger.info() << "WARNING: no reads passed the length filter " << min_read_size << "." << std::endl;
@@ -11,5 +11,5 @@
 #include "common/omp_utils.hpp"
 
 std::vector<hashing::htype> constructMinimizers(logging::Logger &logger, const io::Library &reads_file, size_t threads,
-                                       const hashing::RollingHash &hasher, const size_t w);
+                                       const hashing::RollingHash &hasher, const size_t w, size_t min_count = 1);
 
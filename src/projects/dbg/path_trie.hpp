@@ -0,0 +1,284 @@
+#pragma once
+
+#include "sequences/sequence.hpp"
+#include "common/verify.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace dbg {
+//    Radix tree of read subpaths that start at the same vertex. Paths are compact paths: sequences of first nucleotides
+//    of consecutive edges. Every node stores the part of the path leading to it from its parent as a subsequence of the
+//    first path that created the node, so paths with common prefixes share nodes and nucleotide buffers. Nodes keep the
+//    number of paths ending in them and the number of paths in their subtree so insertion, deletion, prefix counting and
+//    extension queries take time proportional to the length of the query and do not depend on the number of paths.
+//    Removal frees nodes that are left without paths and merges nodes that are left with one child and no ending paths
+//    so the tree never has more nodes than after inserting the remaining paths into an empty tree.
+    class PathTrie {
+    private:
+        static constexpr uint32_t NONE = uint32_t(-1);
+
+        struct Node {
+            Sequence label;
+            size_t ending = 0;
+            size_t total = 0;
+            uint32_t next[4] = {NONE, NONE, NONE, NONE};
+        };
+
+//        nodes[0] is the root with empty label. It is created with the first path and removed with the last one.
+        std::vector<Node> nodes;
+        std::vector<uint32_t> free_nodes;
+
+        static size_t commonPrefix(const Sequence &label, const Sequence &seq, size_t pos) {
+            return label.commonPrefix(seq.Subseq(pos));
+        }
+
+        uint32_t newNode(const Sequence &label) {
+            uint32_t res;
+            if(free_nodes.empty()) {
+                res = uint32_t(nodes.size());
+                nodes.emplace_back();
+            } else {
+                res = free_nodes.back();
+                free_nodes.pop_back();
+            }
+            nodes[res].label = label;
+            return res;
+        }
+
+        void freeNode(uint32_t node) {
+            nodes[node] = Node();
+            free_nodes.push_back(node);
+        }
+
+//        Splits label of the node after len nucleotides. The node keeps the first part and all paths that go through it.
+        void split(uint32_t node, size_t len) {
+            uint32_t tail = newNode(nodes[node].label.Subseq(len));
+            Node &head = nodes[node];
+            nodes[tail].ending = head.ending;
+            nodes[tail].total = head.total;
+            std::copy(head.next, head.next + 4, nodes[tail].next);
+            std::fill(head.next, head.next + 4, NONE);
+            head.next[head.label[len]] = tail;
+            head.label = head.label.Subseq(0, len);
+            head.ending = 0;
+        }
+
+//        Merges the node with its only child if no paths end in the node. The root is never merged.
+        void merge(uint32_t node) {
+            if(node == 0 || nodes[node].ending > 0)
+                return;
+            uint32_t child = NONE;
+            for(uint32_t nxt : nodes[node].next) {
+                if(nxt == NONE)
+                    continue;
+                if(child != NONE)
+                    return;
+                child = nxt;
+            }
+            VERIFY(child != NONE);
+            Node &head = nodes[node];
+            head.label = head.label + nodes[child].label;
+            head.ending = nodes[child].ending;
+            std::copy(nodes[child].next, nodes[child].next + 4, head.next);
+            freeNode(child);
+        }
+
+//        Returns the deepest node such that the path to the middle or the end of its label is seq. The subtree of this
+//        node contains exactly the paths that start with seq. matched is set to the number of label nucleotides in seq.
+//        Returns NONE if no stored path starts with seq.
+        uint32_t locate(const Sequence &seq, size_t &matched) const {
+            matched = 0;
+            if(nodes.empty())
+                return NONE;
+            uint32_t cur = 0;
+            size_t pos = 0;
+            while(pos < seq.size()) {
+                uint32_t nxt = nodes[cur].next[seq[pos]];
+                if(nxt == NONE)
+                    return NONE;
+                const Sequence &label = nodes[nxt].label;
+                size_t len = commonPrefix(label, seq, pos);
+                if(pos + len == seq.size()) {
+                    matched = len;
+                    return nxt;
+                }
+                if(len < label.size())
+                    return NONE;
+                pos += len;
+                cur = nxt;
+            }
+            return cur;
+        }
+
+        template<class F>
+        void forEach(uint32_t node, std::vector<unsigned char> &prefix, const F &f) const {
+            const Node &cur = nodes[node];
+            size_t old_size = prefix.size();
+            for(size_t i = 0; i < cur.label.size(); i++)
+                prefix.push_back(cur.label[i]);
+            if(cur.ending > 0)
+                f(Sequence(prefix), cur.ending);
+            for(uint32_t nxt : cur.next) {
+                if(nxt != NONE)
+                    forEach(nxt, prefix, f);
+            }
+            prefix.resize(old_size);
+        }
+
+    public:
+        PathTrie() = default;
+        PathTrie(PathTrie &&other) = default;
+        PathTrie &operator=(PathTrie &&other) = default;
+        PathTrie(const PathTrie &other) = delete;
+        PathTrie &operator=(const PathTrie &other) = delete;
+
+//        Total number of stored paths counted with multiplicity
+        size_t size() const {
+            return nodes.empty() ? 0 : nodes[0].total;
+        }
+
+//        Number of nodes in use and number of allocated node slots including freed ones
+        size_t nodeCount() const {return nodes.size() - free_nodes.size();}
+        size_t nodeCapacity() const {return nodes.size();}
+
+        void clear() {
+            nodes.clear();
+            free_nodes.clear();
+            nodes.shrink_to_fit();
+            free_nodes.shrink_to_fit();
+        }
+
+        void add(const Sequence &seq) {
+            if(nodes.empty())
+                newNode(Sequence());
+            uint32_t cur = 0;
+            size_t pos = 0;
+            nodes[cur].total++;
+            while(pos < seq.size()) {
+                unsigned char c = seq[pos];
+                uint32_t nxt = nodes[cur].next[c];
+                if(nxt == NONE) {
+                    nxt = newNode(seq.Subseq(pos));
+                    nodes[cur].next[c] = nxt;
+                    nodes[nxt].total = 1;
+                    nodes[nxt].ending = 1;
+                    return;
+                }
+                size_t len = commonPrefix(nodes[nxt].label, seq, pos);
+                if(len < nodes[nxt].label.size())
+                    split(nxt, len);
+                nodes[nxt].total++;
+                pos += len;
+                cur = nxt;
+            }
+            nodes[cur].ending++;
+        }
+
+//        Removes one copy of the path. Returns false and does not change anything if the path is not stored.
+//        Nodes that are left without paths are freed immediately.
+        bool remove(const Sequence &seq) {
+            size_t matched = 0;
+            uint32_t node = locate(seq, matched);
+            if(node == NONE || matched != nodes[node].label.size() || nodes[node].ending == 0)
+                return false;
+            nodes[node].ending--;
+            if(nodes[0].total == 1) {
+                clear();
+                return true;
+            }
+            nodes[0].total--;
+            uint32_t cur = 0;
+            size_t pos = 0;
+            bool detached = false;
+//            Deepest node of the path that keeps some paths. It is the only node that can be left with one child.
+            uint32_t last = 0;
+            while(pos < seq.size()) {
+                unsigned char c = seq[pos];
+                uint32_t nxt = nodes[cur].next[c];
+                pos += nodes[nxt].label.size();
+                nodes[nxt].total--;
+                if(detached) {
+                    freeNode(cur);
+                } else if(nodes[nxt].total == 0) {
+                    nodes[cur].next[c] = NONE;
+                    detached = true;
+                } else {
+                    last = nxt;
+                }
+                cur = nxt;
+            }
+            if(detached)
+                freeNode(cur);
+            merge(last);
+            return true;
+        }
+
+//        Number of stored paths that start with seq
+        size_t countStartsWith(const Sequence &seq) const {
+            size_t matched = 0;
+            uint32_t node = locate(seq, matched);
+            return node == NONE ? 0 : nodes[node].total;
+        }
+
+//        Position in the tree after reading a path: node whose label contains the end of the path and the number of label
+//        nucleotides read. Lets callers extend a query one nucleotide at a time without rebuilding the query sequence.
+        struct Cursor {
+            uint32_t node = NONE;
+            size_t matched = 0;
+        };
+
+        Cursor find(const Sequence &seq) const {
+            Cursor res;
+            res.node = locate(seq, res.matched);
+            return res;
+        }
+
+//        Moves the cursor from path seq to path seq + c
+        void advance(Cursor &cursor, unsigned char c) const {
+            if(cursor.node == NONE)
+                return;
+            const Node &cur = nodes[cursor.node];
+            if(cursor.matched < cur.label.size()) {
+                if(cur.label[cursor.matched] == c)
+                    cursor.matched++;
+                else
+                    cursor.node = NONE;
+            } else {
+                cursor.node = cur.next[c];
+                cursor.matched = 1;
+            }
+        }
+
+//        For every nucleotide c number of stored paths that start with the path of the cursor followed by c
+        std::array<size_t, 4> countExtensions(const Cursor &cursor) const {
+            std::array<size_t, 4> res = {0, 0, 0, 0};
+            if(cursor.node == NONE)
+                return res;
+            const Node &cur = nodes[cursor.node];
+            if(cursor.matched < cur.label.size()) {
+                res[cur.label[cursor.matched]] = cur.total;
+            } else {
+                for(size_t c = 0; c < 4; c++) {
+                    if(cur.next[c] != NONE)
+                        res[c] = nodes[cur.next[c]].total;
+                }
+            }
+            return res;
+        }
+
+//        For every nucleotide c number of stored paths that start with seq + c
+        std::array<size_t, 4> countExtensions(const Sequence &seq) const {
+            return countExtensions(find(seq));
+        }
+
+//        Calls f(path, count) for every distinct stored path. Paths are reported before their extensions.
+        template<class F>
+        void forEach(const F &f) const {
+            if(nodes.empty())
+                return;
+            std::vector<unsigned char> prefix;
+            forEach(0, prefix, f);
+        }
+    };
+}
@@ -68,6 +68,7 @@ double dbg::Path::minCoverage() const {
 
 Sequence dbg::Path::Seq() const {
     SequenceBuilder sb;
+    sb.reserve(start().seq.size() + len());
     sb.append(start().seq);
     for (const Edge *e : path) {
         sb.append(e->seq);
@@ -77,6 +78,7 @@ Sequence dbg::Path::Seq() const {
 
 Sequence dbg::Path::truncSeq() const {
     SequenceBuilder sb;
+    sb.reserve(len());
     for (const Edge *e : path) {
         sb.append(e->seq);
     }
@@ -460,26 +462,37 @@ dbg::GraphAlignment dbg::GraphAligner::align(const Sequence &seq) const {
     size_t k = dbg.hasher().getK();
     GraphAlignment res;
     if (kmers.size() == 0) {
-        hashing::KWH kwh(dbg.hasher(), seq, 0);
-        while (true) {
-            if (dbg.isAnchor(kwh.hash())) {
-                EdgePosition pos = dbg.getAnchor(kwh);
-                VERIFY(kwh.pos < pos.pos);
-                VERIFY(pos.pos + seq.size() - kwh.pos <= pos.edge->size() + k);
-                Segment<Edge> seg(*pos.edge, pos.pos - kwh.pos, pos.pos + seq.size() - kwh.pos - k);
+//        Anchors are looked up in chunks so that lookups of consecutive k-mers overlap while the scan still stops soon
+//        after the first anchor
+        const size_t chunk_size = 64;
+        hashing::KmerHashBuffer hashes(dbg.hasher(), seq);
+        std::vector<hashing::htype> chunk;
+        std::vector<const EdgePosition *> found;
+        for(size_t start = 0; start < hashes.size(); start += chunk_size) {
+            size_t end = std::min(hashes.size(), start + chunk_size);
+            chunk.clear();
+            for(size_t i = start; i < end; i++)
+                chunk.push_back(hashes.hash(i));
+            found.resize(chunk.size());
+            dbg.findAnchors(chunk.begin(), chunk.end(), found.begin());
+            for(size_t i = start; i < end; i++) {
+                const EdgePosition *anchor = found[i - start];
+                if(anchor == nullptr)
+                    continue;
+                EdgePosition pos = hashes.isCanonical(i) ? *anchor : anchor->RC();
+                VERIFY(i < pos.pos);
+                VERIFY(pos.pos + seq.size() - i <= pos.edge->size() + k);
+                Segment<Edge> seg(*pos.edge, pos.pos - i, pos.pos + seq.size() - i - k);
                 return {pos.edge->start(), std::vector<Segment<Edge>>({seg})};
             }
-            if (!kwh.hasNext()) {
-#pragma omp critical
-                {
-                    std::cout << "Error: could not align sequence " << seq.size() << std::endl;
-                    std::cout << seq << std::endl;
-                    abort();
-                };
-                return res;
-            }
-            kwh = kwh.next();
         }
+#pragma omp critical
+        {
+            std::cout << "Error: could not align sequence " << seq.size() << std::endl;
+            std::cout << seq << std::endl;
+            abort();
+        };
+        return res;
     }
     Vertex *prestart = &dbg.getVertex(kmers.front());
     if (kmers.front().pos > 0) {
@@ -594,18 +607,13 @@ std::vector<dbg::PerfectAlignment<Contig, dbg::Edge>> dbg::GraphAligner::careful
                 if ((res.empty() || kwh.pos > res.back().seg_from.right)
                     && kwh.pos > 0 && rcVertex.hasOutgoing(seq[kwh.pos - 1] ^ 3)) {
                     Edge &edge = rcVertex.getOutgoing(seq[kwh.pos - 1] ^ 3);
-                    size_t len = 1;
-                    while (len < edge.size() && len < kwh.pos && edge.seq[len] == (seq[kwh.pos - len - 1] ^ 3))
-                        len += 1;
+                    size_t len = 1 + edge.seq.Subseq(1).commonPrefix((!seq.Subseq(0, kwh.pos)).Subseq(1));
                     res.emplace_back(Segment<Contig>(contig, kwh.pos - len, kwh.pos),
                                      Segment<Edge>(edge.rc(), edge.size() - len, edge.size()));
                 }
                 if (kwh.pos + k < seq.size() && vertex.hasOutgoing(seq[kwh.pos + k])) {
                     Edge &edge = vertex.getOutgoing(seq[kwh.pos + k]);
-                    size_t len = 1;
-                    while (len < edge.size() && kwh.pos + k + len < seq.size() &&
-                           edge.seq[len] == seq[kwh.pos + k + len])
-                        len += 1;
+                    size_t len = 1 + edge.seq.Subseq(1).commonPrefix(seq.Subseq(kwh.pos + k + 1));
                     res.emplace_back(Segment<Contig>(contig, kwh.pos, kwh.pos + len),
                                      Segment<Edge>(edge, 0, len));
                 }
@@ -614,20 +622,23 @@ std::vector<dbg::PerfectAlignment<Contig, dbg::Edge>> dbg::GraphAligner::careful
 //                TODO replace this code with a call to expand method of PerfectAlignment class after each edge is marked by its full sequence
                 Edge &edge = *pos.edge;
                 Vertex &start = *pos.edge->start();
-                CompositeSequence edge_seq({start.seq, edge.seq});
                 size_t left_from = kwh.pos;
                 size_t right_from = kwh.pos + k;
                 size_t left_to = pos.pos;
                 size_t right_to = pos.pos + k;
-                while (left_from > 0 && left_to > 0 && edge_seq[left_to - 1] == seq[left_from - 1]) {
-                    left_from -= 1;
-                    left_to -= 1;
+                if (left_to > start.seq.size()) {
+                    size_t len = seq.Subseq(0, left_from).commonSuffix(edge.seq.Subseq(0, left_to - start.seq.size()));
+                    left_from -= len;
+                    left_to -= len;
                 }
-                while (right_from < seq.size() && right_to < edge_seq.size() &&
-                       seq[right_from] == edge_seq[right_to]) {
-                    right_from += 1;
-                    right_to += 1;
+                if (left_to <= start.seq.size()) {
+                    size_t len = seq.Subseq(0, left_from).commonSuffix(start.seq.Subseq(0, left_to));
+                    left_from -= len;
+                    left_to -= len;
                 }
+                size_t right_len = seq.Subseq(right_from).commonPrefix(edge.seq.Subseq(right_to - start.seq.size()));
+                right_from += right_len;
+                right_to += right_len;
                 if (left_to - left_from > k) {
                     res.emplace_back(Segment<Contig>(contig, left_from, right_from - k),
                                      Segment<Edge>(edge, left_to, right_to - k));
@@ -645,11 +656,8 @@ PerfectAlignment<Contig, dbg::Edge> bestExtension(const Vertex &vertex, const Se
     PerfectAlignment<Contig, dbg::Edge> best({seg.contig(), seg.left, seg.left}, {Edge::fake(), 0, 0});
     for(Edge &edge : vertex) {
         size_t len = 0;
-        while(len < edge.size() && seg.left + vertex.seq.size() + len < seg.contig().size()) {
-            if(seg.contig()[seg.left + vertex.seq.size() + len] != edge.seq[len])
-                break;
-            len++;
-        }
+        if(seg.left + vertex.seq.size() < seg.contig().size())
+            len = edge.seq.commonPrefix(seg.contig().seq.Subseq(seg.left + vertex.seq.size()));
 //        std::cout << len << std::endl;
 //        std::cout << Segment<Contig>(seg.contig(), seg.left + vertex.seq.size(),
 //                                     std::min(seg.contig().size(), seg.left + vertex.seq.size() + 200)).seq() << std::endl;
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Read name interned in a process wide table. Equal names share one record, so every distinct name is stored once no
+//matter how many storages or phases refer to it, and copying or comparing ReadIds for equality compares pointers.
+//The table is split into shards by hash of the name. Each shard has its own lock, open addressing index and arena
+//blocks. Records are never freed because ReadIds are copied freely between storages.
+class ReadId {
+private:
+    static constexpr size_t BLOCK_SIZE = size_t(1) << 20u;
+    static constexpr size_t SHARDS = 64;
+
+    struct Shard {
+        std::mutex lock;
+//        Hash of the name and its record. Empty slots hold nullptr.
+        std::vector<std::pair<uint64_t, const char *>> index;
+        size_t size = 0;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char *cur = nullptr;
+        char *end = nullptr;
+    };
+
+//    Points to the name size followed by the name characters
+    const char *rec;
+
+    static const char *emptyRecord() {
+        static const char res[sizeof(uint32_t)] = {};
+        return res;
+    }
+
+    static Shard *shards() {
+        static Shard res[SHARDS];
+        return res;
+    }
+
+    static size_t recordSize(const char *rec) {
+        uint32_t res;
+        memcpy(&res, rec, sizeof(uint32_t));
+        return res;
+    }
+
+//    FNV-1a
+    static uint64_t hashName(const char *name, size_t size) {
+        uint64_t res = 0xcbf29ce484222325ull;
+        for(size_t i = 0; i < size; i++)
+            res = (res ^ uint8_t(name[i])) * 0x100000001b3ull;
+        return res;
+    }
+
+    static char *allocate(Shard &shard, size_t bytes) {
+        if(bytes > BLOCK_SIZE / 16) {
+            shard.blocks.emplace_back(new char[bytes]);
+            return shard.blocks.back().get();
+        }
+        if(shard.cur == nullptr || size_t(shard.end - shard.cur) < bytes) {
+            shard.blocks.emplace_back(new char[BLOCK_SIZE]);
+            shard.cur = shard.blocks.back().get();
+            shard.end = shard.cur + BLOCK_SIZE;
+        }
+        char *res = shard.cur;
+        shard.cur += bytes;
+        return res;
+    }
+
+    static void grow(Shard &shard) {
+        std::vector<std::pair<uint64_t, const char *>> index(std::max<size_t>(shard.index.size() * 2, 1024),
+                                                             {0, nullptr});
+        size_t mask = index.size() - 1;
+        for(const std::pair<uint64_t, const char *> &slot : shard.index) {
+            if(slot.second == nullptr)
+                continue;
+            size_t pos = (slot.first / SHARDS) & mask;
+            while(index[pos].second != nullptr)
+                pos = (pos + 1) & mask;
+            index[pos] = slot;
+        }
+        std::swap(index, shard.index);
+    }
+
+    static const char *intern(const char *name, size_t size) {
+        if(size == 0)
+            return emptyRecord();
+        uint64_t hash = hashName(name, size);
+        Shard &shard = shards()[hash % SHARDS];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        if((shard.size + 1) * 2 > shard.index.size())
+            grow(shard);
+        size_t mask = shard.index.size() - 1;
+        for(size_t pos = (hash / SHARDS) & mask;; pos = (pos + 1) & mask) {
+            std::pair<uint64_t, const char *> &slot = shard.index[pos];
+            if(slot.second == nullptr) {
+                char *res = allocate(shard, sizeof(uint32_t) + size);
+                uint32_t sz = uint32_t(size);
+                memcpy(res, &sz, sizeof(uint32_t));
+                memcpy(res + sizeof(uint32_t), name, size);
+                slot = {hash, res};
+                shard.size++;
+                return res;
+            }
+            if(slot.first == hash && recordSize(slot.second) == size &&
+                    memcmp(slot.second + sizeof(uint32_t), name, size) == 0)
+                return slot.second;
+        }
+    }
+
+public:
+    ReadId() : rec(emptyRecord()) {}
+
+    ReadId(const std::string &name) : rec(intern(name.data(), name.size())) {}
+
+    ReadId(const char *name) : rec(intern(name, strlen(name))) {}
+
+    size_t size() const {return recordSize(rec);}
+    bool empty() const {return size() == 0;}
+    const char *data() const {return rec + sizeof(uint32_t);}
+    std::string str() const {return {data(), size()};}
+    operator std::string() const {return str();}
+
+    bool operator==(const ReadId &other) const {return rec == other.rec;}
+    bool operator!=(const ReadId &other) const {return rec != other.rec;}
+
+    bool operator<(const ReadId &other) const {
+        return std::lexicographical_compare(data(), data() + size(), other.data(), other.data() + other.size());
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &os, const ReadId &id) {
+    return os.write(id.data(), id.size());
+}
+
+inline std::string operator+(const std::string &s, const ReadId &id) {return s + id.str();}
+inline std::string operator+(char c, const ReadId &id) {return c + id.str();}
@@ -74,11 +74,7 @@ Vertex *Edge::end() const {
 }
 
 size_t Edge::common(const Sequence &other) const {
-    size_t res = 0;
-    while(res < seq.size() && res < other.size() && seq[res] == other[res]) {
-        res += 1;
-    }
-    return res;
+    return seq.commonPrefix(other);
 }
 
 size_t Edge::size() const {
@@ -177,7 +173,6 @@ Sequence Edge::firstNucl() const {
 //}
 
 Vertex::Vertex(hashing::htype hash, Vertex *_rc) : hash_(hash), rc_(_rc), canonical(false) {
-    omp_init_lock(&writelock);
 }
 
 bool Vertex::isCanonical() const {
@@ -285,9 +280,9 @@ Edge &Vertex::addEdgeLockFree(const Edge &edge) {
 }
 
 void Vertex::addEdge(const Edge &e) {
-    omp_set_lock(&writelock);
+    lock();
     addEdgeLockFree(e);
-    omp_unset_lock(&writelock);
+    unlock();
 }
 
 Edge &Vertex::getOutgoing(unsigned char c) const {
@@ -314,6 +309,16 @@ bool Vertex::hasOutgoing(unsigned char c) const {
     return false;
 }
 
+void Vertex::removeOutgoing(unsigned char c) {
+    for (auto it = outgoing_.begin(); it != outgoing_.end(); ++it) {
+        if (it->seq[0] == c) {
+            outgoing_.erase(it);
+            return;
+        }
+    }
+    VERIFY(false);
+}
+
 bool Vertex::operator<(const Vertex &other) const {
     return hash_ < other.hash_ || (hash_ == other.hash_ && canonical && !other.canonical);
 }
@@ -332,7 +337,6 @@ void Vertex::clearOutgoing() {
 }
 
 Vertex::Vertex(hashing::htype hash) : hash_(hash), rc_(new Vertex(hash, this)), canonical(true) {
-    omp_init_lock(&writelock);
 }
 
 Vertex::~Vertex() {
@@ -480,6 +484,7 @@ void SparseDBG::checkDBGConsistency(size_t threads, logging::Logger &logger) {
     logger.trace() << "Checking kmer index" << std::endl;
     std::function<void(size_t, Edge &)> task =
             [this](size_t pos, Edge &edge) {
+                SequenceArena::Scope arena;
                 hashing::KWH kwh(hasher(), edge.start()->seq + edge.seq, 0);
                 while (true) {
                     if(this->containsVertex(kwh.hash())) {
@@ -592,78 +597,102 @@ std::array<Vertex *, 2> SparseDBG::getVertices(hashing::htype hash) {
     return {&res, &res.rc()};
 }
 
+//Calls f(pos, fhash, rhash) for k-mers of the edge that end at positions stride, 2 * stride, ... smaller than edge size.
+//Hashes are rolled along the packed edge sequence, or computed from scratch when stride is larger than k, so that no
+//buffers proportional to the edge length are created.
+template<class F>
+static void forEachSampledKmer(const hashing::RollingHash &hasher, const Edge &edge, size_t stride, const F &f) {
+    size_t k = hasher.getK();
+    const Sequence &seq = edge.seq;
+    Sequence rc = !seq;
+    size_t pos = stride;
+//    These k-mers overlap the start vertex
+    for(; pos < seq.size() && pos < k; pos += stride) {
+        Sequence kmer = edge.kmerSeq(pos);
+        f(pos, hasher.hash(kmer, 0), hasher.hash(!kmer, 0));
+    }
+    if(pos >= seq.size())
+        return;
+    hashing::htype fhash = hasher.hash(seq, pos - k);
+    hashing::htype rhash = hasher.hash(rc, seq.size() - pos);
+    while(true) {
+        f(pos, fhash, rhash);
+        size_t next = pos + stride;
+        if(next >= seq.size())
+            break;
+        if(stride <= k) {
+            for(; pos < next; pos++) {
+                fhash = hasher.next(seq, pos - k, fhash);
+                rhash = hasher.prev(rc, seq.size() - pos, rhash);
+            }
+        } else {
+            pos = next;
+            fhash = hasher.hash(seq, pos - k);
+            rhash = hasher.hash(rc, seq.size() - pos);
+        }
+    }
+}
+
 void SparseDBG::fillAnchors(size_t w, logging::Logger &logger, size_t threads) {
     logger.trace() << "Adding anchors from long edges for alignment" << std::endl;
-    ParallelRecordCollector<std::pair<const hashing::htype, EdgePosition>> res(threads);
+    ParallelRecordCollector<anchor_map_type::value_type> res(threads);
     std::function<void(size_t, Edge &)> task = [&res, w, this](size_t pos, Edge &edge) {
-        Vertex &vertex = *edge.start();
         if (edge.size() > w) {
-            Sequence seq = vertex.seq + edge.seq;
+            SequenceArena::Scope arena;
 //                    Does not run for the first and last kmers.
-            for (hashing::KWH kmer(this->hasher_, seq, 1); kmer.hasNext(); kmer = kmer.next()) {
-                if (kmer.pos % w == 0) {
-                    EdgePosition ep(edge, kmer.pos);
-                    if (kmer.isCanonical())
-                        res.emplace_back(kmer.hash(), ep);
-                    else {
-                        res.emplace_back(kmer.hash(), ep.RC());
-                    }
-                }
-            }
+            forEachSampledKmer(this->hasher_, edge, w, [&res, &edge](size_t pos, hashing::htype fhash, hashing::htype rhash) {
+                EdgePosition ep(edge, pos);
+                if (fhash < rhash)
+                    res.emplace_back(fhash, ep);
+                else
+                    res.emplace_back(rhash, ep.RC());
+            });
         }
     };
     processObjects(edges().begin(), edges().end(), logger, threads, task);
-    for (auto &tmp : res) {
-        anchors.emplace(tmp);
-    }
+    anchors.insert(res.collect(), threads);
     logger.trace() << "Added " << anchors.size() << " anchors" << std::endl;
 }
 
 void SparseDBG::fillAnchors(size_t w, logging::Logger &logger, size_t threads,
                             const std::unordered_set<hashing::htype, hashing::alt_hasher<hashing::htype>> &to_add) {
+    if(to_add.empty()) {
+        fillAnchors(w, logger, threads);
+        return;
+    }
     logger.trace() << "Adding anchors from long edges for alignment" << std::endl;
-    ParallelRecordCollector<std::pair<const hashing::htype, EdgePosition>> res(threads);
+    ParallelRecordCollector<anchor_map_type::value_type> res(threads);
     std::function<void(size_t, Edge &)> task = [&res, w, this, &to_add](size_t pos, Edge &edge) {
-        Vertex &vertex = *edge.start();
-        if (edge.size() > w || !to_add.empty()) {
-            Sequence seq = vertex.seq + edge.seq;
-//                    Does not run for the first and last kmers.
-            for (hashing::KWH kmer(this->hasher_, seq, 1); kmer.hasNext(); kmer = kmer.next()) {
-                if (kmer.pos % w == 0 || to_add.find(kmer.hash()) != to_add.end()) {
-                    EdgePosition ep(edge, kmer.pos);
-                    if (kmer.isCanonical())
-                        res.emplace_back(kmer.hash(), ep);
-                    else {
-                        res.emplace_back(kmer.hash(), ep.RC());
-                    }
-                }
+        SequenceArena::Scope arena;
+//                    Does not run for the first and last kmers. Every kmer is checked against to_add.
+        forEachSampledKmer(this->hasher_, edge, 1, [&res, &edge, &to_add, w](size_t pos, hashing::htype fhash, hashing::htype rhash) {
+            hashing::htype hash = std::min(fhash, rhash);
+            if (pos % w == 0 || to_add.find(hash) != to_add.end()) {
+                EdgePosition ep(edge, pos);
+                res.emplace_back(hash, fhash < rhash ? ep : ep.RC());
             }
-        }
+        });
     };
     processObjects(edges().begin(), edges().end(), logger, threads, task);
-    for (auto &tmp : res) {
-        anchors.emplace(tmp);
-    }
+    anchors.insert(res.collect(), threads);
     logger.trace() << "Added " << anchors.size() << " anchors" << std::endl;
 }
 
 EdgePosition SparseDBG::getAnchor(const hashing::KWH &kwh) {
     if (kwh.isCanonical())
-        return anchors.find(kwh.hash())->second;
+        return *anchors.find(kwh.hash());
     else
-        return anchors.find(kwh.hash())->second.RC();
+        return anchors.find(kwh.hash())->RC();
 }
 
 std::vector<hashing::KWH> SparseDBG::extractVertexPositions(const Sequence &seq, size_t max) const {
     std::vector<hashing::KWH> res;
-    hashing::KWH kwh(hasher(), seq, 0);
-    while (true) {
-        if (containsVertex(kwh.hash())) {
-            res.emplace_back(kwh);
+    hashing::KmerHashBuffer kmers(hasher(), seq);
+    VERIFY(kmers.size() > 0);
+    for (size_t pos = 0; pos < kmers.size() && res.size() != max; pos++) {
+        if (containsVertex(kmers.hash(pos))) {
+            res.emplace_back(kmers.kwh(pos));
         }
-        if (!kwh.hasNext() || res.size() == max)
-            break;
-        kwh = kwh.next();
     }
     return std::move(res);
 }
@@ -9,18 +9,32 @@
 #include "common/logging.hpp"
 #include "common/rolling_hash.hpp"
 #include "common/hash_utils.hpp"
+#include "common/perfect_hash.hpp"
+#include "common/static_hash_index.hpp"
+#include "common/spin_lock.hpp"
 #include <common/oneline_utils.hpp>
 #include <common/iterator_utils.hpp>
+#include <atomic>
 #include <vector>
 #include <numeric>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace dbg {
+//    Lock that guards outgoing edges, sequence and read records of a vertex. One byte spin lock by default and
+//    omp_lock_t if the project is configured with LJA_VERTEX_OMP_LOCKS.
+#ifdef LJA_VERTEX_OMP_LOCKS
+    typedef OmpLock VertexLock;
+#else
+    typedef SpinLock VertexLock;
+#endif
+
     class Vertex;
 
     class SparseDBG;
 
+    class DBGCheckpoint;
+
     class Edge {
     private:
         Vertex *start_;
@@ -70,13 +84,14 @@ namespace dbg {
     class Vertex {
     private:
         friend class SparseDBG;
+        friend class DBGCheckpoint;
         mutable std::vector<Edge> outgoing_{};
         Vertex *rc_;
         hashing::htype hash_;
-        omp_lock_t writelock = {};
         size_t coverage_ = 0;
         bool canonical = false;
-        bool mark_ = false;
+        std::atomic<bool> mark_{false};
+        VertexLock writelock;
         explicit Vertex(hashing::htype hash, Vertex *_rc);
     public:
         Sequence seq;
@@ -85,15 +100,18 @@ namespace dbg {
         Vertex(const Vertex &) = delete;
         ~Vertex();
 
-        void mark() {mark_ = true;}
-        void unmark() {mark_ = false;}
-        bool marked() const {return mark_;}
+        void mark() {mark_.store(true, std::memory_order_relaxed);}
+        void unmark() {mark_.store(false, std::memory_order_relaxed);}
+        bool marked() const {return mark_.load(std::memory_order_relaxed);}
+//        Marks the vertex and returns true if it was not marked before. Used to give ownership of a graph fragment to
+//        exactly one of the threads that reach it.
+        bool claim() {return !mark_.exchange(true, std::memory_order_acq_rel);}
         hashing::htype hash() const {return hash_;}
         Vertex &rc() {return *rc_;}
         const Vertex &rc() const {return *rc_;}
         void setSequence(const Sequence &_seq);
-        void lock() {omp_set_lock(&writelock);}
-        void unlock() {omp_unset_lock(&writelock);}
+        void lock() {writelock.lock();}
+        void unlock() {writelock.unlock();}
         std::vector<Edge>::iterator begin() const {return outgoing_.begin();}
         std::vector<Edge>::iterator end() const {return outgoing_.end();}
         size_t outDeg() const {return outgoing_.size();}
@@ -117,6 +135,8 @@ namespace dbg {
         void addEdge(const Edge &e);
         Edge &getOutgoing(unsigned char c) const;
         bool hasOutgoing(unsigned char c) const;
+//        Removes the outgoing edge that starts with nucleotide c. References to other outgoing edges are invalidated.
+        void removeOutgoing(unsigned char c);
         bool isJunction() const;
 
         bool operator==(const Vertex &other) const;
@@ -142,11 +162,13 @@ namespace dbg {
 
     class SparseDBG {
     public:
-        typedef std::unordered_map<hashing::htype , Vertex, hashing::alt_hasher<hashing::htype>> vertex_map_type;
-        typedef std::unordered_map<hashing::htype, Vertex, hashing::alt_hasher<hashing::htype>>::iterator vertex_iterator_type;
-        typedef std::unordered_map<hashing::htype, EdgePosition, hashing::alt_hasher<hashing::htype>> anchor_map_type;
+        typedef hashing::PerfectHashMap<Vertex> vertex_map_type;
+        typedef vertex_map_type::iterator vertex_iterator_type;
+        typedef hashing::StaticHashIndex<EdgePosition> anchor_map_type;
     private:
-//    TODO: replace with perfect hash map? It is parallel, maybe faster and compact.
+//    Vertices are stored in a flat array indexed by a perfect hash if the graph was constructed with a vertex hash list
+//    and in an ordinary hash map otherwise. Vertices added later always go to the hash map.
+        friend class DBGCheckpoint;
         vertex_map_type v;
         anchor_map_type anchors;
         hashing::RollingHash hasher_;
@@ -168,6 +190,9 @@ namespace dbg {
                 ++begin;
             }
         }
+//        Builds vertex index in parallel using minimal perfect hash. Hashes must be distinct, e.g. sorted and deduplicated.
+        SparseDBG(const std::vector<hashing::htype> &hash_list, hashing::RollingHash _hasher, size_t threads) :
+                    v(hash_list, threads), hasher_(_hasher) {}
         explicit SparseDBG(hashing::RollingHash _hasher) : hasher_(_hasher) {}
         SparseDBG(SparseDBG &&other) = default;
         SparseDBG &operator=(SparseDBG &&other) = default;
@@ -185,9 +210,15 @@ namespace dbg {
         Vertex &getVertex(const Vertex &other_graph_vertex);
         std::array<Vertex *, 2> getVertices(hashing::htype hash);
 //        const Vertex &getVertex(const hashing::KWH &kwh) const;
-        bool isAnchor(hashing::htype hash) const {return anchors.find(hash) != anchors.end();}
+        bool isAnchor(hashing::htype hash) const {return anchors.contains(hash);}
+//        Writes pointer to the anchor of each hash in the range or nullptr. Lookups of consecutive hashes overlap.
+        template<class I, class O>
+        O findAnchors(I begin, I end, O out) const {return anchors.findAll(begin, end, out);}
+        void clearAnchors() {anchors.clear();}
         EdgePosition getAnchor(const hashing::KWH &kwh);
         size_t size() const {return v.size();}
+//        True if some vertices are stored in the perfect hash array
+        bool hasPerfectVertexIndex() const {return v.staticSize() > 0;}
 
         void checkConsistency(size_t threads, logging::Logger &logger);
         void checkDBGConsistency(size_t threads, logging::Logger &logger);
@@ -4,7 +4,12 @@
 #include <unordered_map>
 #include <common/verify.hpp>
 #include <unordered_set>
+#include <algorithm>
 #include "vector"
+
+//Max flow network with lower bounds on edge flows. Flow is found with Dinic algorithm. Every edge has a twin reverse edge
+//with negative id that holds residual capacity. Multiplicity bounds of all edges are answered from one analysis of the
+//residual graph that is cached until the flow or the network changes.
 class Network {
 public:
     struct Vertex;
@@ -29,6 +34,7 @@ public:
 
 private:
     int innerAddEdge(size_t from, size_t to, size_t max_capacity, size_t flow = 0) {
+        loops_valid = false;
         int eid = edges.size() + 1;
         edges.emplace_back(eid, from, to, max_capacity, flow);
         back_edges.emplace_back(-eid, to, from, 0);
@@ -45,6 +51,18 @@ protected:
     std::vector<Edge> back_edges;
     size_t source;
     size_t sink;
+//    Whether edge with given arc index lies on a cycle of the residual graph. Valid only if loops_valid is true.
+    std::vector<char> loop_cache;
+    bool loops_valid = false;
+
+//    Edges and their reverse twins are numbered 0..2*edges.size()-1 so that twin of arc a is a ^ 1
+    static size_t arcIndex(int id) {
+        return id > 0 ? size_t(id - 1) * 2 : size_t(-id - 1) * 2 + 1;
+    }
+
+    static int arcId(size_t arc) {
+        return arc % 2 == 0 ? int(arc / 2 + 1) : -int(arc / 2 + 1);
+    }
 
 public:
     Edge &getEdge(int id) {
@@ -88,8 +106,9 @@ public:
 private:
     std::vector<int> bfs(int startId, int endId, int avoidEdge = 0) {
         std::queue<size_t> queue;
-        std::unordered_map<size_t, int> prev;
-        prev[startId] = 0;
+        std::vector<int> prev(vertices.size(), 0);
+        std::vector<char> visited(vertices.size(), false);
+        visited[startId] = true;
         queue.push(startId);
         while(!queue.empty()) {
             size_t next = queue.front();
@@ -105,7 +124,8 @@ private:
             for(int eid : vertices[next].out) {
                 Edge &edge = getEdge(eid);
                 size_t end = edge.end;
-                if(edge.id != avoidEdge && edge.capacity > 0 && prev.find(end) == prev.end()) {
+                if(edge.id != avoidEdge && edge.capacity > 0 && !visited[end]) {
+                    visited[end] = true;
                     prev[end] = eid;
                     queue.emplace(end);
                 }
@@ -115,6 +135,7 @@ private:
     }
 
     void pushFlow(int edgeId, size_t val = 1) {
+        loops_valid = false;
         VERIFY(val <= getEdge(edgeId).capacity);
         getEdge(edgeId).capacity -= val;
         getEdge(-edgeId).capacity += val;
@@ -141,20 +162,281 @@ private:
         return indeg;
     }
 
+    std::vector<int> buildLevels() {
+        std::vector<int> level(vertices.size(), -1);
+        std::queue<size_t> queue;
+        level[source] = 0;
+        queue.push(source);
+        while(!queue.empty()) {
+            size_t next = queue.front();
+            queue.pop();
+            for(int eid : vertices[next].out) {
+                Edge &edge = getEdge(eid);
+                if(edge.capacity > 0 && level[edge.end] < 0) {
+                    level[edge.end] = level[next] + 1;
+                    queue.push(edge.end);
+                }
+            }
+        }
+        return std::move(level);
+    }
+
+//    Pushes at most limit units of flow along shortest paths of the residual graph. Returns pushed value.
+    size_t blockingFlow(std::vector<int> &level, size_t limit) {
+        std::vector<size_t> next_arc(vertices.size(), 0);
+        std::vector<int> path;
+        size_t total = 0;
+        size_t cur = source;
+        while(total < limit) {
+            if(cur == sink) {
+                size_t val = limit - total;
+                for(int eid : path)
+                    val = std::min(val, getEdge(eid).capacity);
+                pushFlow(path, val);
+                total += val;
+                path.clear();
+                cur = source;
+                continue;
+            }
+            bool advanced = false;
+            for(; next_arc[cur] < vertices[cur].out.size(); next_arc[cur]++) {
+                Edge &edge = getEdge(vertices[cur].out[next_arc[cur]]);
+                if(edge.capacity > 0 && level[edge.end] == level[cur] + 1) {
+                    path.push_back(edge.id);
+                    cur = edge.end;
+                    advanced = true;
+                    break;
+                }
+            }
+            if(!advanced) {
+                if(cur == source)
+                    break;
+                level[cur] = -1;
+                cur = getEdge(path.back()).start;
+                path.pop_back();
+                next_arc[cur]++;
+            }
+        }
+        return total;
+    }
+
+//    Strongly connected components of the residual graph (iterative Tarjan algorithm)
+    std::vector<size_t> residualComponents() {
+        const size_t none = size_t(-1);
+        std::vector<size_t> comp(vertices.size(), none);
+        std::vector<size_t> index(vertices.size(), none);
+        std::vector<size_t> low(vertices.size(), 0);
+        std::vector<size_t> next_arc(vertices.size(), 0);
+        std::vector<size_t> stack;
+        std::vector<size_t> call_stack;
+        size_t counter = 0;
+        size_t comp_num = 0;
+        for(size_t start = 0; start < vertices.size(); start++) {
+            if(index[start] != none)
+                continue;
+            call_stack.push_back(start);
+            index[start] = low[start] = counter++;
+            stack.push_back(start);
+            while(!call_stack.empty()) {
+                size_t v = call_stack.back();
+                if(next_arc[v] < vertices[v].out.size()) {
+                    Edge &edge = getEdge(vertices[v].out[next_arc[v]]);
+                    next_arc[v]++;
+                    if(edge.capacity == 0)
+                        continue;
+                    size_t u = edge.end;
+                    if(index[u] == none) {
+                        index[u] = low[u] = counter++;
+                        stack.push_back(u);
+                        call_stack.push_back(u);
+                    } else if(comp[u] == none) {
+                        low[v] = std::min(low[v], index[u]);
+                    }
+                    continue;
+                }
+                call_stack.pop_back();
+                if(!call_stack.empty())
+                    low[call_stack.back()] = std::min(low[call_stack.back()], low[v]);
+                if(low[v] == index[v]) {
+                    while(true) {
+                        size_t u = stack.back();
+                        stack.pop_back();
+                        comp[u] = comp_num;
+                        if(u == v)
+                            break;
+                    }
+                    comp_num++;
+                }
+            }
+        }
+        return std::move(comp);
+    }
+
+//    Finds bridges of the flowgraph on vertices 0..n-1 with given arcs and start vertices: arcs that belong to every path
+//    from a start vertex to their end. Every vertex must be reachable from a start vertex. Dominators are computed with
+//    the iterative algorithm of Cooper, Harvey and Kennedy. Arc (x, y) is a bridge iff x is the immediate dominator of y
+//    and y dominates starts of all other arcs entering y.
+    static std::vector<char> flowgraphBridges(size_t n, const std::vector<std::pair<size_t, size_t>> &arcs,
+                                              const std::vector<size_t> &starts) {
+        size_t root = n;
+        std::vector<std::vector<size_t>> out(n + 1);
+        std::vector<std::vector<size_t>> in(n + 1);
+        for(size_t i = 0; i < arcs.size(); i++) {
+            out[arcs[i].first].push_back(arcs[i].second);
+            in[arcs[i].second].push_back(arcs[i].first);
+        }
+        for(size_t v : starts) {
+            out[root].push_back(v);
+            in[v].push_back(root);
+        }
+        const size_t none = size_t(-1);
+        std::vector<size_t> post(n + 1, none);
+        std::vector<size_t> order;
+        std::vector<char> visited(n + 1, false);
+        std::vector<std::pair<size_t, size_t>> stack = {{root, 0}};
+        visited[root] = true;
+        while(!stack.empty()) {
+            size_t v = stack.back().first;
+            size_t &pos = stack.back().second;
+            if(pos < out[v].size()) {
+                size_t u = out[v][pos];
+                pos++;
+                if(!visited[u]) {
+                    visited[u] = true;
+                    stack.emplace_back(u, 0);
+                }
+            } else {
+                post[v] = order.size();
+                order.push_back(v);
+                stack.pop_back();
+            }
+        }
+        VERIFY(order.size() == n + 1);
+        std::vector<size_t> idom(n + 1, none);
+        idom[root] = root;
+        bool changed = true;
+        while(changed) {
+            changed = false;
+            for(size_t i = order.size() - 1; i-- > 0;) {
+                size_t v = order[i];
+                size_t new_idom = none;
+                for(size_t p : in[v]) {
+                    if(idom[p] == none)
+                        continue;
+                    if(new_idom == none) {
+                        new_idom = p;
+                        continue;
+                    }
+                    size_t a = p;
+                    size_t b = new_idom;
+                    while(a != b) {
+                        while(post[a] < post[b])
+                            a = idom[a];
+                        while(post[b] < post[a])
+                            b = idom[b];
+                    }
+                    new_idom = a;
+                }
+                if(idom[v] != new_idom) {
+                    idom[v] = new_idom;
+                    changed = true;
+                }
+            }
+        }
+        std::vector<std::vector<size_t>> children(n + 1);
+        for(size_t v = 0; v < n; v++)
+            children[idom[v]].push_back(v);
+        std::vector<size_t> tin(n + 1);
+        std::vector<size_t> tout(n + 1);
+        size_t timer = 0;
+        stack = {{root, 0}};
+        tin[root] = timer++;
+        while(!stack.empty()) {
+            size_t v = stack.back().first;
+            size_t &pos = stack.back().second;
+            if(pos < children[v].size()) {
+                size_t u = children[v][pos];
+                pos++;
+                tin[u] = timer++;
+                stack.emplace_back(u, 0);
+            } else {
+                tout[v] = timer++;
+                stack.pop_back();
+            }
+        }
+        auto dominates = [&tin, &tout](size_t a, size_t b) {
+            return tin[a] <= tin[b] && tout[b] <= tout[a];
+        };
+        std::vector<size_t> not_dominated(n + 1, 0);
+        for(const std::pair<size_t, size_t> &arc : arcs) {
+            if(!dominates(arc.second, arc.first))
+                not_dominated[arc.second]++;
+        }
+        std::vector<char> res(arcs.size(), false);
+        for(size_t i = 0; i < arcs.size(); i++) {
+            res[i] = idom[arcs[i].second] == arcs[i].first && not_dominated[arcs[i].second] == 1;
+        }
+        return std::move(res);
+    }
+
+//    Edge (x, y) of the residual graph lies on a cycle that does not use its twin (y, x) iff x and y are in the same
+//    strongly connected component and the twin is absent or is not a strong bridge, i.e. y can reach x without it.
+//    Strong bridges are arcs that are bridges of the flowgraph or of the reverse flowgraph started from any vertex of
+//    each component (Italiano, Laura, Santaroni).
+    void computeLoops() {
+        std::vector<size_t> comp = residualComponents();
+        std::vector<size_t> starts;
+        std::vector<char> has_start(vertices.size(), false);
+        for(size_t v = 0; v < vertices.size(); v++) {
+            if(!has_start[comp[v]]) {
+                has_start[comp[v]] = true;
+                starts.push_back(v);
+            }
+        }
+        size_t arc_num = edges.size() * 2;
+        std::vector<size_t> inner;
+        std::vector<std::pair<size_t, size_t>> forward;
+        std::vector<std::pair<size_t, size_t>> backward;
+        for(size_t arc = 0; arc < arc_num; arc++) {
+            Edge &edge = getEdge(arcId(arc));
+            if(edge.capacity > 0 && edge.start != edge.end && comp[edge.start] == comp[edge.end]) {
+                inner.push_back(arc);
+                forward.emplace_back(edge.start, edge.end);
+                backward.emplace_back(edge.end, edge.start);
+            }
+        }
+        std::vector<char> forward_bridges = flowgraphBridges(vertices.size(), forward, starts);
+        std::vector<char> backward_bridges = flowgraphBridges(vertices.size(), backward, starts);
+        std::vector<char> strong_bridge(arc_num, false);
+        loop_cache.assign(arc_num, false);
+        for(size_t i = 0; i < inner.size(); i++) {
+            strong_bridge[inner[i]] = forward_bridges[i] || backward_bridges[i];
+            loop_cache[inner[i]] = true;
+        }
+        for(size_t arc : inner) {
+            if(getEdge(arcId(arc ^ 1)).capacity > 0 && strong_bridge[arc ^ 1])
+                loop_cache[arc] = false;
+        }
+        loops_valid = true;
+    }
+
 public:
     bool fillNetwork() {
         size_t outdeg = outCapasity(source);
-        for(size_t i = 0; i < outdeg; i++) {
-            std::vector<int> path = bfs(source, sink);
-            if(path.empty())
+        size_t flow = 0;
+        while(flow < outdeg) {
+            std::vector<int> level = buildLevels();
+            if(level[sink] < 0)
                 return false;
-            pushFlow(path, 1);
+            flow += blockingFlow(level, outdeg - flow);
         }
         return true;
     }
 
     bool isInLoop(int edgeId) {
-        return getEdge(edgeId).capacity > 0 && !findLoop(edgeId).empty();
+        if(!loops_valid)
+            computeLoops();
+        return loop_cache[arcIndex(edgeId)];
     }
 
     std::vector<int> findLoop(int edgeId) {
@@ -350,6 +350,7 @@ GraphAlignment ManyKCorrector::ReadRecord::getBlock(size_t num) const {
 
 size_t ManyKCorrect(logging::Logger &logger, SparseDBG &dbg, RecordStorage &reads_storage, double threshold,
                     double reliable_threshold, size_t K, size_t expectedCoverage, size_t threads) {
+    logging::StageTimer timer("ManyKCorrect K=" + std::to_string(K));
     FillReliableWithConnections(logger, dbg, reliable_threshold);
     logger.info() << "Correcting low covered regions in reads with K = " << K << std::endl;
     ManyKCorrector corrector(dbg, reads_storage, K, expectedCoverage, reliable_threshold, threshold);
@@ -357,6 +357,7 @@ void DrawMult(const std::experimental::filesystem::path &dir, dbg::SparseDBG &db
 RecordStorage MultCorrect(SparseDBG &dbg, logging::Logger &logger, const std::experimental::filesystem::path &dir,
                           RecordStorage &reads_storage, size_t unique_threshold, size_t threads, bool diploid,
                           bool debug) {
+    logging::StageTimer timer("MultCorrect");
     const std::experimental::filesystem::path multiplicity_figures = dir / "mult_figs";
     const std::experimental::filesystem::path dump_dir = dir / "mult";
     if(debug) {
@@ -364,7 +365,7 @@ RecordStorage MultCorrect(SparseDBG &dbg, logging::Logger &logger, const std::ex
         recreate_dir(dump_dir);
     }
     UniqueClassificator classificator(dbg, reads_storage, diploid, debug);
-    classificator.classify(logger, unique_threshold, multiplicity_figures/"ongoing");
+    classificator.classify(logger, threads, unique_threshold, multiplicity_figures/"ongoing");
     if(debug)
         DrawMult(multiplicity_figures / "round1", dbg, unique_threshold, reads_storage, classificator);
     CorrectBasedOnUnique(logger, threads, dbg, reads_storage, classificator, dump_dir/"round1.txt");
@@ -389,5 +390,5 @@ void NewMultCorrect(SparseDBG &sdbg, logging::Logger &logger, const std::experim
     recreate_dir(multiplicity_figures);
     SetUniquenessStorage initial_unique = BulgePathAnalyser(sdbg, unique_threshold).uniqueEdges();
     MultiplicityBoundsEstimator estimator(sdbg, initial_unique);
-    estimator.update(logger, 3, multiplicity_figures);
+    estimator.update(logger, threads, 3, multiplicity_figures);
 }
@@ -1,4 +1,5 @@
 #include <common/simple_computation.hpp>
+#include <numeric>
 #include "diploidy_analysis.hpp"
 #include "multiplicity_estimation.hpp"
 using namespace dbg;
@@ -101,26 +102,59 @@ bool MultiplicityBoundsEstimator::updateComponent(logging::Logger &logger, const
     return false;
 }
 
-void MultiplicityBoundsEstimator::update(logging::Logger &logger, double rel_coverage,
+//Runs task for every component in parallel. Largest components are started first so that a few huge components do not
+//delay the end of the stage. Every task logs into its own buffer and the buffers are printed in the order of components
+//when all tasks are finished so that the log does not depend on the number of threads.
+static void processComponents(logging::Logger &logger, size_t threads, const std::vector<Component> &components,
+                              const std::function<void(logging::Logger &, size_t)> &task) {
+    std::vector<size_t> order(components.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&components](size_t a, size_t b) {
+        return components[a].size() > components[b].size();
+    });
+    std::vector<std::stringstream> logs(components.size());
+    omp_set_num_threads(threads);
+#pragma omp parallel for default(none) schedule(dynamic, 1) shared(logger, order, logs, task)
+    for(size_t i = 0; i < order.size(); i++) {
+        logging::Logger component_logger(logger, logs[order[i]]);
+        task(component_logger, order[i]);
+    }
+    for(size_t i = 0; i < logs.size(); i++) {
+        std::string log = logs[i].str();
+        if(!log.empty())
+            logger.trace() << "Messages of component " << i + 1 << ":\n" << log;
+    }
+}
+
+void MultiplicityBoundsEstimator::update(logging::Logger &logger, size_t threads, double rel_coverage,
                                          const std::experimental::filesystem::path &dir) {
     ensure_dir_existance(dir);
-    size_t cnt = 0;
-    for(const Component &component : UniqueSplitter(bounds).splitGraph(dbg)) {
-        if(component.size() <= 2)
-            continue;
-        cnt += 1;
+    std::vector<Component> split;
+    for(Component &component : UniqueSplitter(bounds).splitGraph(dbg)) {
+        if(component.size() > 2)
+            split.emplace_back(std::move(component));
+    }
+    for(const Component &component : split) {
+        bounds.reserveRecords(component);
+    }
+    logger.info() << "Estimating multiplicity bounds in " << split.size() << " components" << std::endl;
+    std::function<void(logging::Logger &, size_t)> task = [this, &split, rel_coverage, &dir](logging::Logger &clogger,
+                                                                                               size_t num) {
+        const Component &component = split[num];
+        std::string cnt = std::to_string(num + 1);
         std::ofstream os1;
-        os1.open(dir / (std::to_string(cnt) + "_before.dot"));
+        os1.open(dir / (cnt + "_before.dot"));
         printDot(os1, component, bounds.labeler(), bounds.colorer());
         os1.close();
-        updateComponent(logger, component, bounds, rel_coverage);
-        std::experimental::filesystem::path out_file = dir / (std::to_string(cnt) + ".dot");
-        logger << "Printing component to " << out_file << std::endl;
+        updateComponent(clogger, component, bounds, rel_coverage);
+        std::experimental::filesystem::path out_file = dir / (cnt + ".dot");
+        clogger << "Printing component to " << out_file << std::endl;
         std::ofstream os;
         os.open(out_file);
         printDot(os, component, bounds.labeler(), bounds.colorer());
         os.close();
-    }
+    };
+    processComponents(logger, threads, split, task);
 }
 
 void UniqueClassificator::markPseudoHets() const {
@@ -152,7 +186,7 @@ void UniqueClassificator::markPseudoHets() const {
     }
 }
 
-void UniqueClassificator::classify(logging::Logger &logger, size_t unique_len,
+void UniqueClassificator::classify(logging::Logger &logger, size_t threads, size_t unique_len,
                                    const std::experimental::filesystem::path &dir) {
     logger.info() << "Looking for unique edges" << std::endl;
     if(debug)
@@ -213,27 +247,33 @@ void UniqueClassificator::classify(logging::Logger &logger, size_t unique_len,
     markPseudoHets();
     logger.info() << "Splitting graph with unique edges" << std::endl;
     std::vector<Component> split = UniqueSplitter(*this).split(Component(dbg));
+    for(const Component &component : split) {
+        reserveRecords(component);
+    }
     logger.info() << "Processing " << split.size() << " components" << std::endl;
-    size_t component_cnt = 0;
-    for(Component &component : split) {
-        component_cnt += 1;
+    std::function<void(logging::Logger &, size_t)> task = [this, &split, &dir, &cnt](logging::Logger &clogger,
+                                                                                      size_t num) {
+        Component &component = split[num];
+        size_t component_cnt = num + 1;
         if(debug)
             printDot(dir / (std::to_string(component_cnt) + ".dot"), component, reads_storage.labeler());
-        //TODO make parallel trace
-        logger.trace() << "Component parameters: size=" << component.size() << " border=" << component.countBorderEdges() <<
+        clogger.trace() << "Component parameters: size=" << component.size() << " border=" << component.countBorderEdges() <<
                       " tips=" << component.countTips() <<
                       " subcomponents=" << component.realCC() << " acyclic=" << component.isAcyclic() <<std::endl;
         if(component.size() > 2 && component.countBorderEdges() == 2 &&component.countTips() == 0 &&
            component.realCC() == 2 && component.isAcyclic()) {
-            processSimpleComponent(logger, component);
+            processSimpleComponent(clogger, component);
         }
-        cnt += processComponent(logger, component);
+        size_t found = processComponent(clogger, component);
+#pragma omp atomic
+        cnt += found;
         if(debug)
-            logger.trace() << "Printing component to " << (dir / (std::to_string(component_cnt) + ".dot")) << std::endl;
+            clogger.trace() << "Printing component to " << (dir / (std::to_string(component_cnt) + ".dot")) << std::endl;
         if(debug)
             printDot(dir / (std::to_string(component_cnt) + ".dot"), component,
                      this->labeler() + reads_storage.labeler(), this->colorer());
-    }
+    };
+    processComponents(logger, threads, split, task);
     logger.info() << "Finished unique edges search. Found " << cnt << " unique edges" << std::endl;
     logger.info() << "Analysing repeats of multiplicity 2 and looking for additional unique edges" << std::endl;
     std::function<bool(const dbg::Edge &)> mult2 = [this](const dbg::Edge &edge) {
@@ -38,7 +38,7 @@ public:
 
     bool updateComponent(logging::Logger &logger, const dbg::Component &component, const AbstractUniquenessStorage &uniquenessStorage,
                                 double rel_coverage, double unique_coverage = 0);
-    void update(logging::Logger &logger, double rel_coverage, const std::experimental::filesystem::path &dir);
+    void update(logging::Logger &logger, size_t threads, double rel_coverage, const std::experimental::filesystem::path &dir);
 };
 std::pair<double, double> minmaxCov(const dbg::Component &subcomponent, const RecordStorage &reads_storage,
                                     const std::function<bool(const dbg::Edge &)> &is_unique);
@@ -54,7 +54,7 @@ public:
 
     void markPseudoHets() const;
 
-    void classify(logging::Logger &logger, size_t unique_len, const std::experimental::filesystem::path &dir);
+    void classify(logging::Logger &logger, size_t threads, size_t unique_len, const std::experimental::filesystem::path &dir);
     explicit UniqueClassificator(dbg::SparseDBG &dbg, const RecordStorage &reads_storage, bool diploid, bool debug) :
                     dbg(dbg), reads_storage(reads_storage), diploid(diploid), debug(debug) {}
     size_t ProcessUsingCoverage(logging::Logger &logger, const dbg::Component &subcomponent,
@@ -127,7 +127,7 @@ private:
 public:
     size_t upperBound(const dbg::Edge &edge) const {
         auto it = multiplicity_bounds.find(&edge);
-        if(it == multiplicity_bounds.end())
+        if(it == multiplicity_bounds.end() || it->second.upperBound == BoundRecord::inf)
             return inf;
         else return it->second.upperBound;
     }
@@ -175,10 +175,20 @@ public:
         return it->second.isUnique();
     }
 
+//    Creates empty records for all inner edges of the component. Updates of existing records do not change the map so
+//    after this bounds of inner edges of disjoint components can be updated from different threads.
+    void reserveRecords(const dbg::Component &component) {
+        for(dbg::Edge &edge : component.edgesInner()) {
+            multiplicity_bounds[&edge];
+            multiplicity_bounds[&edge.rc()];
+        }
+    }
+
     std::function<std::string(const dbg::Edge &)> labeler() const {
         return [this](const dbg::Edge &edge) -> std::string {
             auto it = multiplicity_bounds.find(&edge);
-            if(it == multiplicity_bounds.end()) {
+            if(it == multiplicity_bounds.end() ||
+                    (it->second.lowerBound == 0 && it->second.upperBound == BoundRecord::inf)) {
                 return "";
             }
             std::stringstream ss;
@@ -140,6 +140,8 @@ std::string constructMessage() {
     ss << "  -w <int> (or --window <int>`)                 The window size to be used for sparse de Bruijn graph construction. The default value is 2000. Note that all reads of length less than k + w are ignored during graph construction.\n";
     ss << "  --compress                                    Compress all homolopymers in reads.\n";
     ss << "  --coverage                                    Calculate edge coverage of edges in the constructed de Bruijn graph.\n";
+    ss << "  --perfect-hash                                Store graph vertices in a flat array indexed by a minimal perfect hash function. Reduces memory usage on large graphs.\n";
+    ss << "  --save-checkpoint                             Save constructed graph to binary checkpoint dbg.bin in the output folder. It is reused when the graph is constructed again from the same disjointigs and vertices files.\n";
     return ss.str();
 }
 
@@ -149,7 +151,7 @@ int main(int argc, char **argv) {
                      "simplify", "coverage", "cov-threshold=2", "rel-threshold=10", "tip-correct",
                      "initial-correct", "mult-correct", "mult-analyse", "compress", "dimer-compress=1000000000,1000000000,1", "help", "genome-path",
                      "dump", "extension-size=none", "print-all", "extract-subdatasets", "print-alignments", "subdataset-radius=10000",
-                     "split", "diploid"},
+                     "split", "diploid", "perfect-hash", "save-checkpoint"},
                     {"reads", "pseudo-reads", "align", "paths", "print-segment"},
                     {"h=help", "o=output-dir", "t=threads", "k=k-mer-size","w=window"},
                     constructMessage());
@@ -206,7 +208,8 @@ int main(int argc, char **argv) {
     std::string vertices_file = parser.getValue("vertices");
     std::string dbg_file = parser.getValue("dbg");
     SparseDBG dbg = dbg_file == "none" ?
-                    DBGPipeline(logger, hasher, w, construction_lib, dir, threads, disjointigs_file, vertices_file) :
+                    DBGPipeline(logger, hasher, w, construction_lib, dir, threads, disjointigs_file, vertices_file,
+                                parser.getCheck("perfect-hash"), parser.getCheck("save-checkpoint")) :
                     LoadDBGFromFasta({std::experimental::filesystem::path(dbg_file)}, hasher, logger, threads);
 
     bool calculate_alignments = parser.getCheck("initial-correct") ||
@@ -240,12 +243,15 @@ int main(int argc, char **argv) {
     RecordStorage refStorage(dbg, 0, extension_size, threads, readLogger, false, false);
 
     if(calculate_alignments) {
+//        Reads and reference are aligned to the same graph so they share one frozen copy
+        FrozenGraph frozen(dbg, threads);
         logger.info() << "Collecting read alignments" << std::endl;
-        io::SeqReader reader(reads_lib);
-        readStorage.fill(reader.begin(), reader.end(), dbg, w + k - 1, logger, threads);
+        io::ReadLibrary(reads_lib, [&readStorage, &frozen, w, k, &logger, threads](auto begin, auto end) {
+            readStorage.fill(begin, end, frozen, w + k - 1, logger, threads);
+        });
         logger.info() << "Collecting reference alignments" << std::endl;
         io::SeqReader refReader(genome_lib);
-        refStorage.fill(refReader.begin(), refReader.end(), dbg, w + k - 1, logger, threads);
+        refStorage.fill(refReader.begin(), refReader.end(), frozen, w + k - 1, logger, threads);
     }
 
     if(parser.getCheck("mult-analyse")) {
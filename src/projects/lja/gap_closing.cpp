@@ -4,10 +4,9 @@
 
 bool GapCloser::HasInnerDuplications(const Sequence &seq, const hashing::RollingHash &hasher) {
     std::vector<hashing::htype> hashs;
-    for(hashing::KWH kwh(hasher, seq, 0);; kwh = kwh.next()) {
-        hashs.emplace_back(kwh.hash());
-        if(!kwh.hasNext())
-            break;
+    hashing::KmerHashBuffer kmers(hasher, seq);
+    for(size_t pos = 0; pos < kmers.size(); pos++) {
+        hashs.emplace_back(kmers.hash(pos));
     }
     std::sort(hashs.begin(), hashs.end());
     return std::unique(hashs.begin(), hashs.end()) != hashs.end();
@@ -28,12 +27,9 @@ std::vector<Connection> GapCloser::GapPatches(logging::Logger &logger, dbg::Spar
 #pragma omp parallel for default(none) shared(tips, candidates, dbg, smallHasher)
     for (size_t i = 0; i < tips.size(); i++) {
         size_t max_len = std::min(tips[i]->size(), max_overlap);
-        hashing::KWH kwh(smallHasher, tips[i]->seq, tips[i]->size() - max_len);
-        while (true) {
-            candidates.emplace_back(kwh.hash(), i);
-            if (!kwh.hasNext())
-                break;
-            kwh = kwh.next();
+        hashing::KmerHashBuffer kmers(smallHasher, tips[i]->seq.Subseq(tips[i]->size() - max_len));
+        for (size_t pos = 0; pos < kmers.size(); pos++) {
+            candidates.emplace_back(kmers.hash(pos), i);
         }
     }
     logger.trace() << "Sorting k-mers from tips" << std::endl;
@@ -92,12 +88,8 @@ std::vector<Connection> GapCloser::GapPatches(logging::Logger &logger, dbg::Spar
             if(!new_seq.endsWith(!tips[rec.to]->start()->seq) || !new_seq.startsWith(tips[rec.from]->start()->seq) ||
                HasInnerDuplications(new_seq, dbg.hasher()))
                 continue;
-            size_t left_match = 0;
-            size_t right_match = 0;
-            while(left_match < tips[rec.from]->size() && new_seq[k + left_match] == tips[rec.from]->seq[left_match])
-                left_match++;
-            while(right_match < tips[rec.to]->size() && (!new_seq)[k + right_match] == tips[rec.to]->seq[right_match])
-                right_match++;
+            size_t left_match = tips[rec.from]->seq.commonPrefix(new_seq.Subseq(k));
+            size_t right_match = tips[rec.to]->seq.commonPrefix((!new_seq).Subseq(k));
             dbg::EdgePosition p1(*tips[rec.from], left_match);
             dbg::EdgePosition p2(*tips[rec.to], right_match);
             VERIFY(left_match + right_match + k < new_seq.size());
@@ -11,6 +11,7 @@
 #include "error_correction/precorrection.hpp"
 #include "sequences/seqio.hpp"
 #include "dbg/dbg_construction.hpp"
+#include "dbg/graph_checkpoint.hpp"
 #include "common/rolling_hash.hpp"
 #include "common/dir_utils.hpp"
 #include "common/cl_parser.hpp"
@@ -78,41 +79,46 @@ bool close_gaps, bool remove_bad, bool skip, bool debug, bool load) {
         k += 1;
     }
     ensure_dir_existance(dir);
+    logging::StageTimer timer("AlternativeCorrection k=" + itos(k));
     hashing::RollingHash hasher(k, 239);
     std::function<void()> ic_task = [&dir, &logger, &hasher, close_gaps, load, remove_bad, k, w, &reads_lib,
             &pseudo_reads_lib, &paths_lib, threads, threshold, reliable_coverage, debug] {
         io::Library construction_lib = reads_lib + pseudo_reads_lib;
-        SparseDBG dbg = load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads, (dir/"disjointigs.fasta").string(), (dir/"vertices.save").string()) :
-                        DBGPipeline(logger, hasher, w, reads_lib, dir, threads);
+        SparseDBG dbg = load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads, (dir/"disjointigs.fasta").string(), (dir/"vertices.save").string(), false, debug) :
+                        DBGPipeline(logger, hasher, w, reads_lib, dir, threads, "none", "none", false, debug);
         dbg.fillAnchors(w, logger, threads);
         size_t extension_size = std::max<size_t>(k * 2, 1000);
         ReadLogger readLogger(threads, dir/"read_log.txt");
         RecordStorage readStorage(dbg, 0, extension_size, threads, readLogger, true, true, false);
         RecordStorage refStorage(dbg, 0, extension_size, threads, readLogger, false, false);
-        io::SeqReader reader(reads_lib);
-        readStorage.fill(reader.begin(), reader.end(), dbg, w + k - 1, logger, threads);
+        {
+            FrozenGraph frozen(dbg, threads);
+            io::ReadLibrary(reads_lib, [&readStorage, &frozen, w, k, &logger, threads](auto begin, auto end) {
+                readStorage.fill(begin, end, frozen, w + k - 1, logger, threads);
+            });
+        }
         coverageStats(logger, dbg);
         if(debug) {
             PrintPaths(logger, dir / "state_dump", "initial", dbg, readStorage, paths_lib, true);
         }
         Precorrect(logger, threads, dbg, readStorage, reliable_coverage);
-        RemoveUncovered(logger, threads, dbg, {&readStorage, &refStorage}, extension_size);
+        PruneUncovered(logger, threads, dbg, {&readStorage, &refStorage}, extension_size);
         readStorage.trackSuffixes(logger, threads);
 //        CorrectDimers(logger, readStorage, k, threads, reliable_coverage);
         correctAT(logger, readStorage, k, threads);
         ManyKCorrect(logger, dbg, readStorage, threshold, reliable_coverage, 800, 4, threads);
         if(debug)
             PrintPaths(logger, dir/ "state_dump", "mk800", dbg, readStorage, paths_lib, true);
-        RemoveUncovered(logger, threads, dbg, {&readStorage, &refStorage}, std::max<size_t>(k * 5 / 2, 3000));
+        PruneUncovered(logger, threads, dbg, {&readStorage, &refStorage}, std::max<size_t>(k * 5 / 2, 3000));
         ManyKCorrect(logger, dbg, readStorage, threshold, reliable_coverage, 2000, 4, threads);
         if(debug)
             PrintPaths(logger, dir/ "state_dump", "mk2000", dbg, readStorage, paths_lib, true);
-        RemoveUncovered(logger, threads, dbg, {&readStorage, &refStorage}, std::max<size_t>(k * 7 / 2, 5000));
+        PruneUncovered(logger, threads, dbg, {&readStorage, &refStorage}, std::max<size_t>(k * 7 / 2, 5000));
 //        CorrectDimers(logger, readStorage, k, threads, reliable_coverage);
         correctAT(logger, readStorage, k, threads);
         correctLowCoveredRegions(logger, dbg, readStorage, refStorage, "/dev/null", threshold, reliable_coverage, k, threads, false);
         ManyKCorrect(logger, dbg, readStorage, threshold, reliable_coverage, 3500, 4, threads);
-        RemoveUncovered(logger, threads, dbg, {&readStorage, &refStorage});
+        PruneUncovered(logger, threads, dbg, {&readStorage, &refStorage});
         coverageStats(logger, dbg);
         if(debug)
             PrintPaths(logger, dir/ "state_dump", "mk3500", dbg, readStorage, paths_lib, false);
@@ -138,24 +144,30 @@ std::vector<std::experimental::filesystem::path> NoCorrection(logging::Logger &l
         k += 1;
     }
     ensure_dir_existance(dir);
+    logging::StageTimer timer("NoCorrection k=" + itos(k));
     hashing::RollingHash hasher(k, 239);
     std::function<void()> ic_task = [&dir, &logger, &hasher, load, k, w, &reads_lib,
             &pseudo_reads_lib, &paths_lib, threads, debug] {
         io::Library construction_lib = reads_lib + pseudo_reads_lib;
-        SparseDBG dbg = load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads, (dir/"disjointigs.fasta").string(), (dir/"vertices.save").string()) :
-                        DBGPipeline(logger, hasher, w, reads_lib, dir, threads);
+        SparseDBG dbg = load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads, (dir/"disjointigs.fasta").string(), (dir/"vertices.save").string(), false, debug) :
+                        DBGPipeline(logger, hasher, w, reads_lib, dir, threads, "none", "none", false, debug);
         dbg.fillAnchors(w, logger, threads);
         size_t extension_size = std::max<size_t>(k * 2, 1000);
         ReadLogger readLogger(threads, dir/"read_log.txt");
         RecordStorage readStorage(dbg, 0, extension_size, threads, readLogger, true, true, false);
         RecordStorage extra_reads(dbg, 0, extension_size, threads, readLogger, false, true, false);
-        io::SeqReader reader(reads_lib);
-        readStorage.fill(reader.begin(), reader.end(), dbg, w + k - 1, logger, threads);
+        {
+            FrozenGraph frozen(dbg, threads);
+            io::ReadLibrary(reads_lib, [&readStorage, &frozen, w, k, &logger, threads](auto begin, auto end) {
+                readStorage.fill(begin, end, frozen, w + k - 1, logger, threads);
+            });
+        }
         coverageStats(logger, dbg);
         if(debug) {
             PrintPaths(logger, dir / "state_dump", "initial", dbg, readStorage, paths_lib, true);
         }
         dbg.printFastaOld(dir / "final_dbg.fasta");
+        DBGCheckpoint::Save(dir / "final_dbg.bin", dbg);
         printDot(dir / "final_dbg.dot", Component(dbg), readStorage.labeler());
         printGFA(dir / "final_dbg.gfa", Component(dbg), true);
         SaveAllReads(dir/"final_dbg.aln", {&readStorage, &extra_reads});
@@ -179,6 +191,7 @@ std::vector<std::experimental::filesystem::path> SecondPhase(
         k += 1;
     }
     ensure_dir_existance(dir);
+    logging::StageTimer timer("SecondPhase k=" + itos(k));
     hashing::RollingHash hasher(k, 239);
     std::function<void()> ic_task = [&dir, &logger, &hasher, load, k, w,
                                      &reads_lib, &pseudo_reads_lib, &paths_lib,
@@ -189,15 +202,19 @@ std::vector<std::experimental::filesystem::path> SecondPhase(
         SparseDBG dbg =
             load ? DBGPipeline(logger, hasher, w, reads_lib, dir, threads,
                                (dir/"disjointigs.fasta").string(),
-                               (dir/"vertices.save").string())
-                 : DBGPipeline(logger, hasher, w, reads_lib, dir, threads);
+                               (dir/"vertices.save").string(), false, debug)
+                 : DBGPipeline(logger, hasher, w, reads_lib, dir, threads, "none", "none", false, debug);
         dbg.fillAnchors(w, logger, threads);
         size_t extension_size = 10000000;
         ReadLogger readLogger(threads, dir/"read_log.txt");
         RecordStorage readStorage(dbg, 0, extension_size, threads, readLogger, true, debug);
         RecordStorage refStorage(dbg, 0, extension_size, threads, readLogger, false, false);
-        io::SeqReader reader(reads_lib);
-        readStorage.fill(reader.begin(), reader.end(), dbg, w + k - 1, logger, threads);
+        {
+            FrozenGraph frozen(dbg, threads);
+            io::ReadLibrary(reads_lib, [&readStorage, &frozen, w, k, &logger, threads](auto begin, auto end) {
+                readStorage.fill(begin, end, frozen, w + k - 1, logger, threads);
+            });
+        }
         if(debug) {
             DrawSplit(Component(dbg), dir / "before_figs", readStorage.labeler(), 25000);
             PrintPaths(logger, dir / "state_dump", "initial", dbg, readStorage, paths_lib, false);
@@ -212,14 +229,14 @@ std::vector<std::experimental::filesystem::path> SecondPhase(
         readStorage.invalidateBad(logger, threads, threshold, "after_gap1");
         if(debug)
             PrintPaths(logger, dir/ "state_dump", "bad", dbg, readStorage, paths_lib, false);
-        RemoveUncovered(logger, threads, dbg, {&readStorage, &refStorage});
+        PruneUncovered(logger, threads, dbg, {&readStorage, &refStorage});
         if(debug)
             PrintPaths(logger, dir/ "state_dump", "uncovered1", dbg, readStorage, paths_lib, false);
         RecordStorage extra_reads = MultCorrect(dbg, logger, dir, readStorage, unique_threshold, threads, diploid, debug);
         MRescue(logger, threads, dbg, readStorage, unique_threshold, 0.05);
         if(debug)
             PrintPaths(logger, dir/ "state_dump", "mult", dbg, readStorage, paths_lib, false);
-        RemoveUncovered(logger, threads, dbg, {&readStorage, &extra_reads, &refStorage});
+        PruneUncovered(logger, threads, dbg, {&readStorage, &extra_reads, &refStorage});
         if(debug)
             PrintPaths(logger, dir/ "state_dump", "uncovered2", dbg, readStorage, paths_lib, false);
         GapColserPipeline(logger, threads, dbg, {&readStorage, &extra_reads, &refStorage});
@@ -228,6 +245,7 @@ std::vector<std::experimental::filesystem::path> SecondPhase(
             DrawSplit(Component(dbg), dir / "split_figs", readStorage.labeler());
         }
         dbg.printFastaOld(dir / "final_dbg.fasta");
+        DBGCheckpoint::Save(dir / "final_dbg.bin", dbg);
         printDot(dir / "final_dbg.dot", Component(dbg), readStorage.labeler());
         printGFA(dir / "final_dbg.gfa", Component(dbg), true);
         SaveAllReads(dir/"final_dbg.aln", {&readStorage, &extra_reads});
@@ -248,9 +266,14 @@ std::vector<std::experimental::filesystem::path> MDBGPhase(
         const std::experimental::filesystem::path &graph_fasta,
         const std::experimental::filesystem::path &read_paths, bool skip, bool debug) {
     logger.info() << "Performing repeat resolution by transforming de Bruijn graph into Multiplex de Bruijn graph" << std::endl;
+    logging::StageTimer timer("MDBGPhase");
     std::function<void()> ic_task = [&logger, threads, debug, k, kmdbg, &graph_fasta, unique_threshold, diploid, &read_paths, &dir] {
         hashing::RollingHash hasher(k, 239);
-        SparseDBG dbg = dbg::LoadDBGFromFasta({graph_fasta}, hasher, logger, threads);
+        std::experimental::filesystem::path checkpoint = graph_fasta;
+        checkpoint.replace_extension(".bin");
+        SparseDBG dbg = DBGCheckpoint::Check(checkpoint, hasher) ?
+                        DBGCheckpoint::Load(checkpoint, hasher, logger, threads, false) :
+                        dbg::LoadDBGFromFasta({graph_fasta}, hasher, logger, threads);
         size_t extension_size = 10000000;
         ReadLogger readLogger(threads, dir/"read_log.txt");
         RecordStorage readStorage(dbg, 0, extension_size, threads, readLogger, true, debug);
@@ -258,7 +281,7 @@ std::vector<std::experimental::filesystem::path> MDBGPhase(
         LoadAllReads(read_paths, {&readStorage, &extra_reads}, dbg);
         repeat_resolution::RepeatResolver rr(dbg, &readStorage, {&extra_reads},
                                              k, kmdbg, dir, unique_threshold,
-                                             diploid, debug, logger);
+                                             diploid, debug, logger, threads);
         rr.ResolveRepeats(logger, threads);
     };
     if(!skip)
@@ -273,6 +296,7 @@ std::vector<std::experimental::filesystem::path> PolishingPhase(
         const std::experimental::filesystem::path &corrected_reads,
         const io::Library &reads, size_t dicompress, size_t min_alignment, bool skip, bool debug) {
     logger.info() << "Performing polishing and homopolymer uncompression" << std::endl;
+    logging::StageTimer timer("PolishingPhase");
     std::function<void()> ic_task = [&logger, threads, &output_dir, debug, &gfa_file, &corrected_reads, &reads, dicompress, min_alignment, &dir] {
         io::SeqReader reader(corrected_reads);
         multigraph::MultiGraph vertex_graph;
@@ -382,6 +406,8 @@ int main(int argc, char **argv) {
     bool load = parser.getCheck("load");
     bool noec = parser.getCheck("noec");
     logger.info() << "LJA pipeline started" << std::endl;
+    logging::StageTimer::SetStageFile(dir / "stages.jsonl");
+    logging::StageTimer total_timer("lja");
 
     size_t threads = std::stoi(parser.getValue("threads"));
 
@@ -444,6 +470,9 @@ int main(int argc, char **argv) {
     logger.info() << "Final graph with homopolymer compressed edges can be found here: " << resolved[1] << std::endl;
     logger.info() << "Final graph can be found here: " << uncompressed_results[1] << std::endl;
     logger.info() << "Final assembly can be found here: " << uncompressed_results[0] << std::endl;
+    total_timer.finish();
+    logging::StageTimer::WriteReport(dir / "pipeline_report.json");
+    logger.info() << "Resource usage report for pipeline stages can be found here: " << (dir / "pipeline_report.json") << std::endl;
     logger.info() << "LJA pipeline finished" << std::endl;
     return 0;
 }
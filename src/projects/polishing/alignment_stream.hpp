@@ -0,0 +1,99 @@
+#pragma once
+
+#include "common/mmap_utils.hpp"
+#include "common/verify.hpp"
+#include <experimental/filesystem>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//Binary stream of read to contig alignments that is passed from PrintAlignments to the polisher. Reads and contigs are
+//referred to by their index in the id tables stored in the file header so records have fixed size and are read straight
+//from the memory mapped file.
+//Layout: magic, version, number of contigs, number of reads, contig ids, read ids, records sorted by read index.
+//Every id is stored as its length followed by its characters. Read indices follow the order of reads in the aligned
+//library and every record also keeps the ordinal of its read in that library.
+struct AlignmentStreamRecord {
+    uint32_t read_index;
+    uint32_t contig_index;
+    uint32_t read_start;
+    uint32_t read_end;
+    uint64_t contig_start;
+    uint64_t contig_end;
+//    Alignment to the reverse complement of the contig. Coordinates are given on the reverse complement strand.
+    uint32_t rc;
+//    Position of the read in the library that was aligned
+    uint32_t read_ordinal;
+};
+
+class AlignmentStream {
+private:
+    static constexpr uint64_t MAGIC = 0x4d5254534e4c414cull; // "LALNSTRM"
+    static constexpr uint64_t VERSION = 2;
+
+    MappedFile file;
+    std::vector<std::string> contig_ids;
+    std::vector<std::string> read_ids;
+    const char *records_start = nullptr;
+    size_t record_num = 0;
+
+    static void saveId(std::ostream &os, const std::string &id) {
+        writeBinary<uint64_t>(os, id.size());
+        os.write(id.c_str(), id.size());
+    }
+
+    static std::string loadId(BinaryCursor &cursor) {
+        uint64_t len = cursor.read<uint64_t>();
+        return cursor.readString(len);
+    }
+
+public:
+    explicit AlignmentStream(const std::experimental::filesystem::path &fname) : file(fname) {
+        VERIFY_MSG(file.valid(), "Could not open alignment stream " + fname.string());
+        BinaryCursor cursor(file.data(), file.size());
+        VERIFY_MSG(cursor.read<uint64_t>() == MAGIC && cursor.read<uint64_t>() == VERSION,
+                   "Incorrect alignment stream " + fname.string());
+        uint64_t contig_num = cursor.read<uint64_t>();
+        uint64_t read_num = cursor.read<uint64_t>();
+        for(size_t i = 0; i < contig_num; i++)
+            contig_ids.emplace_back(loadId(cursor));
+        for(size_t i = 0; i < read_num; i++)
+            read_ids.emplace_back(loadId(cursor));
+        VERIFY(cursor.left() % sizeof(AlignmentStreamRecord) == 0);
+        record_num = cursor.left() / sizeof(AlignmentStreamRecord);
+        records_start = cursor.current();
+        file.adviseSequential();
+    }
+
+    static bool IsStream(const std::experimental::filesystem::path &fname) {
+        return fname.extension() == ".bin";
+    }
+
+    static void Write(const std::experimental::filesystem::path &fname, const std::vector<std::string> &contig_ids,
+                      const std::vector<std::string> &read_ids, const std::vector<AlignmentStreamRecord> &records) {
+        std::ofstream os(fname, std::ios::binary);
+        writeBinary(os, uint64_t(MAGIC));
+        writeBinary(os, uint64_t(VERSION));
+        writeBinary<uint64_t>(os, contig_ids.size());
+        writeBinary<uint64_t>(os, read_ids.size());
+        for(const std::string &id : contig_ids)
+            saveId(os, id);
+        for(const std::string &id : read_ids)
+            saveId(os, id);
+        os.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(AlignmentStreamRecord));
+        os.close();
+    }
+
+    const std::string &contigId(size_t ind) const {return contig_ids[ind];}
+    const std::string &readId(size_t ind) const {return read_ids[ind];}
+    size_t contigNum() const {return contig_ids.size();}
+    size_t readNum() const {return read_ids.size();}
+    size_t size() const {return record_num;}
+
+    AlignmentStreamRecord operator[](size_t ind) const {
+        AlignmentStreamRecord res{};
+        std::memcpy(&res, records_start + ind * sizeof(AlignmentStreamRecord), sizeof(AlignmentStreamRecord));
+        return res;
+    }
+};
@@ -1,15 +1,18 @@
 #include "homopolish.hpp"
+#include "alignment_stream.hpp"
 #include <sequences/contigs.hpp>
 #include <common/cl_parser.hpp>
 #include <common/logging.hpp>
 #include <sequences/seqio.hpp>
 #include <common/omp_utils.hpp>
 #include <common/zip_utils.hpp>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 #include <iostream>
 #include <array>
+#include <tuple>
 #include <spoa/spoa.hpp>
 #include <ksw2/ksw_wrapper.hpp>
 
@@ -41,6 +44,26 @@ struct AlignmentInfo {
 };
 
 
+struct ContigInfo;
+
+//Maximal run of contig positions where read nucleotides match the contig
+struct VoteRun {
+    size_t coord;
+    size_t read_pos;
+    size_t len;
+};
+
+//Votes of a single alignment. They are collected for many alignments in parallel and then applied to contigs in the
+//order of alignments so that consensus does not depend on the number of threads.
+struct ReadVotes {
+    ContigInfo *contig = nullptr;
+    size_t from = 0;
+    size_t to = 0;
+    vector<size_t> quantities;
+    vector<VoteRun> runs;
+    vector<pair<size_t, string>> complex_strings;
+};
+
 struct dinucleotide {
     size_t start, multiplicity;
     //do we need sequence?
@@ -332,6 +355,12 @@ struct AssemblyInfo {
 
     static const size_t BATCH_SIZE = 100000;
 
+//Number of alignments per thread processed before collected votes are applied
+    static const size_t VOTE_CHUNK = 64;
+
+//Contigs are split into stripes of this length and votes in different stripes are applied in parallel
+    static const size_t VOTE_STRIPE = 1 << 16;
+
     explicit AssemblyInfo (logging::Logger &logger,
                            const std::vector<Contig> &assembly,
                            size_t dicompress) {
@@ -532,10 +561,13 @@ struct AssemblyInfo {
         return res;
     }
 
-    void processReadPair (logging::Logger &logger, string& read, AlignmentInfo& aln) {
+//Aligns read to the contig and collects its votes for homopolymer lengths and its fragments in complex regions.
+//Does not modify contigs.
+    ReadVotes collectVotes(logging::Logger &logger, const string& read, AlignmentInfo& aln) {
+        ReadVotes votes;
 //        logger.info() << read.id << endl;
         if (contigs.find(aln.contig_id) == contigs.end())
-            return;
+            return votes;
         Sequence uncompressed_read_seq (read);
         size_t rlen = read.length();
         vector<size_t> compressed_read_coords;
@@ -554,16 +586,16 @@ struct AssemblyInfo {
         string contig_seq = current_contig.sequence.substr(aln.alignment_start , aln.alignment_end - aln.alignment_start);
         if (compressed_read.length() <= aln.read_start) {
             logger.trace() << "Read " << aln.read_id << " alignment outside the read bounds" <<endl;
-            return;
+            return votes;
         }
         string read_seq = compressed_read.substr(aln.read_start, aln.read_end - aln.read_start);
         auto cigars = getFastAln(logger, aln, contig_seq.c_str(), read_seq.c_str());
         if (matchedLength(cigars) < 50) {
             logger.debug()<< "Read " << aln.read_id << " not aligned " << endl;
-            return;
+            return votes;
         }
         int cur_ind = 0;
-        std:vector<size_t> quantities;
+        vector<size_t> &quantities = votes.quantities;
         quantities.resize(compressed_read.length());
 
         for (size_t i = 0; i < compressed_read.size(); i++){
@@ -575,6 +607,9 @@ struct AssemblyInfo {
             }
             quantities[i] = count;
         }
+        votes.contig = &current_contig;
+        votes.from = aln.alignment_start;
+        votes.to = aln.alignment_start;
         size_t cont_coords = 0; //minimapaln[0].seg_to.left;
         size_t read_coords = 0; //minimapaln[0].seg_from.left;
         read_coords = aln.read_start;
@@ -600,28 +635,20 @@ struct AssemblyInfo {
                 if (complex_regions_iter !=  current_contig.complex_regions.end()) {
                     cur_complex_coord = complex_regions_iter->first;
                 }
-//TODO possibly move critical here;
-#pragma omp critical
                 for (size_t i = MATCH_EPS; i + MATCH_EPS< (*it).length; i++) {
                     size_t coord = cont_coords + aln.alignment_start + i;
-
-
-//                    logger.info() << current_contig.sequence[coord]<< compressed_read[read_coords + i] << endl;
-                    if (current_contig.sequence[coord] == nucl(compressed_read[read_coords + i]) && current_contig.quantity[coord] != 255 && current_contig.sum[coord] < 60000) {
-                        {
-                            current_contig.quantity[coord]++;
-                            current_contig.sum[coord] += quantities[read_coords + i];
-                            if (current_contig.amounts[coord][0] < ContigInfo::VOTES_STORED)
-//#pragma omp critical
-                                current_contig.amounts[coord][++current_contig.amounts[coord][0]] = quantities[
-                                        read_coords + i];
-                        }
+                    votes.to = coord + 1;
+                    if (current_contig.sequence[coord] == nucl(compressed_read[read_coords + i])) {
+                        if (!votes.runs.empty() && votes.runs.back().coord + votes.runs.back().len == coord &&
+                                votes.runs.back().read_pos + votes.runs.back().len == read_coords + i)
+                            votes.runs.back().len++;
+                        else
+                            votes.runs.push_back({coord, read_coords + i, 1});
                         matches ++;
                     } else {
                         mismatches ++;
                     }
 //Only complete traversion of complex regions taken in account;
-//                    if (current_contig.complex_regions.find(coord) != current_contig.complex_regions.end()) {
                     if (coord == cur_complex_coord) {
                         size_t complex_len = complex_regions_iter->second;
                         if (read_coords + complex_len < matchedLength(cigars)) {
@@ -634,8 +661,7 @@ struct AssemblyInfo {
                             cur_complex_coord = complex_regions_iter->first;
                     }
                     if (coord == complex_fragment_finish) {
-//#pragma omp critical
-                        current_contig.complex_strings[complex_id].push_back(uncompressCoords(complex_start, read_coords + i, uncompressed_read_seq.str(), compressed_read_coords));
+                        votes.complex_strings.emplace_back(complex_id, uncompressCoords(complex_start, read_coords + i, uncompressed_read_seq.str(), compressed_read_coords));
                         complex_fragment_finish = -1;
                     } else if (coord > complex_fragment_finish) {
                         logger.debug() << "Read " << aln.read_id << " missed fragment finish " << complex_fragment_finish << endl;
@@ -648,13 +674,73 @@ struct AssemblyInfo {
         }
         if (matches < mismatches * 3)
             logger.debug()<< "Too many mismatches in a read " << aln.read_id << " matches/MM: " << matches << "/" << mismatches << endl;
+        return votes;
+    }
+
+//Applies votes to contig positions in [from, to). Positions with saturated counters do not accept new votes.
+    void applyVotes(const ReadVotes &votes, size_t from, size_t to) {
+        ContigInfo &contig = *votes.contig;
+        for (const VoteRun &run : votes.runs) {
+            size_t start = std::max(run.coord, from);
+            size_t finish = std::min(run.coord + run.len, to);
+            for (size_t coord = start; coord < finish; coord++) {
+                size_t q = votes.quantities[run.read_pos + coord - run.coord];
+                if (contig.quantity[coord] != 255 && contig.sum[coord] < 60000) {
+                    contig.quantity[coord]++;
+                    contig.sum[coord] += q;
+                    if (contig.amounts[coord][0] < ContigInfo::VOTES_STORED)
+                        contig.amounts[coord][++contig.amounts[coord][0]] = q;
+                }
+            }
+        }
+        for (const auto &complex : votes.complex_strings) {
+            if (complex.first >= from && complex.first < to) {
+                auto complex_it = contig.complex_strings.find(complex.first);
+                VERIFY(complex_it != contig.complex_strings.end());
+                complex_it->second.push_back(complex.second);
+            }
+        }
+    }
+
+//Every stripe of every contig is updated by a single thread that applies votes in the order of alignments
+    void mergeVotes(const vector<ReadVotes> &votes) {
+        vector<std::tuple<ContigInfo *, size_t, size_t>> stripes;
+        for (size_t i = 0; i < votes.size(); i++) {
+            if (votes[i].contig == nullptr || votes[i].from == votes[i].to)
+                continue;
+            for (size_t stripe = votes[i].from / VOTE_STRIPE; stripe <= (votes[i].to - 1) / VOTE_STRIPE; stripe++) {
+                stripes.emplace_back(votes[i].contig, stripe, i);
+            }
+        }
+        std::sort(stripes.begin(), stripes.end());
+        vector<size_t> group_starts;
+        for (size_t i = 0; i < stripes.size(); i++) {
+            if (i == 0 || std::get<0>(stripes[i]) != std::get<0>(stripes[i - 1]) ||
+                    std::get<1>(stripes[i]) != std::get<1>(stripes[i - 1]))
+                group_starts.push_back(i);
+        }
+        size_t groups = group_starts.size();
+        group_starts.push_back(stripes.size());
+#pragma omp parallel for schedule(dynamic, 1) default(none) shared(votes, stripes, group_starts, groups)
+        for (size_t g = 0; g < groups; g++) {
+            size_t stripe = std::get<1>(stripes[group_starts[g]]);
+            for (size_t i = group_starts[g]; i < group_starts[g + 1]; i++) {
+                applyVotes(votes[std::get<2>(stripes[i])], stripe * VOTE_STRIPE, (stripe + 1) * VOTE_STRIPE);
+            }
+        }
     }
 
     void processBatch(logging::Logger &logger, vector<string>& batch, vector<AlignmentInfo>& alignments){
         size_t len = batch.size();
-#pragma omp parallel for default(none) shared(logger, len, batch, alignments)
-        for (size_t i = 0; i < len; i++) {
-            processReadPair(logger, batch[i], alignments[i]);
+        size_t chunk = VOTE_CHUNK * omp_get_max_threads();
+        for (size_t chunk_start = 0; chunk_start < len; chunk_start += chunk) {
+            size_t chunk_end = std::min(len, chunk_start + chunk);
+            vector<ReadVotes> votes(chunk_end - chunk_start);
+#pragma omp parallel for schedule(dynamic, 1) default(none) shared(logger, chunk_start, chunk_end, batch, alignments, votes)
+            for (size_t i = chunk_start; i < chunk_end; i++) {
+                votes[i - chunk_start] = collectVotes(logger, batch[i], alignments[i]);
+            }
+            mergeVotes(votes);
         }
     }
 
@@ -723,6 +809,116 @@ struct AssemblyInfo {
         }
         processBatch(logger, contig_batch, align_batch);
         logger.trace() << "Processed final batch of " << align_batch.size() << " compressed reads " << endl;
+        return generateConsensus(logger);
+    }
+
+//Some tools clip read names after whitespaces
+    static string clippedId(string id) {
+        size_t pos = id.find_first_of(" \t\n");
+        if (pos != string::npos)
+            id.resize(pos);
+        return id;
+    }
+
+    static string clippedId(const StringContig &read) {return clippedId(read.id);}
+    static string clippedId(const ContigView &read) {return clippedId(read.getId());}
+    static const string &readSequence(const StringContig &read) {return read.seq;}
+    static string readSequence(const ContigView &read) {return read.seqString();}
+
+//Alignments from binary stream refer to reads by index in the stream. Aligned reads are stored in the order of their
+//ordinals in the aligned library. Polished reads are read from lib, which has these reads in the same relative order:
+//it is either the same library or the original reads that lja corrected and aligned. So reads are fetched in one pass
+//that compares every read only with the next expected one, like process does for text alignments. Reads that this pass
+//misses because lib has a different order are looked up by name in a second pass. Every library read is matched to at
+//most one aligned read, so aligned reads with equal names are matched to different reads.
+    vector<Contig> processStream(logging::Logger &logger, const io::Library &lib,
+                                 const std::experimental::filesystem::path &alignmens_file) {
+        AlignmentStream stream(alignmens_file);
+        logger.trace() << "Loaded " << stream.size() << " alignments of " << stream.readNum() << " reads\n";
+        std::vector<std::pair<size_t, size_t>> read_alignments(stream.readNum(), {0, 0});
+        for (size_t i = 0; i < stream.size(); ) {
+            size_t read_index = stream[i].read_index;
+            VERIFY(i == 0 || (read_index > stream[i - 1].read_index &&
+                              stream[i].read_ordinal > stream[i - 1].read_ordinal));
+            size_t j = i;
+            while (j < stream.size() && stream[j].read_index == read_index)
+                j++;
+            read_alignments[read_index] = {i, j};
+            i = j;
+        }
+        std::vector<char> found(stream.readNum(), false);
+        size_t found_count = 0;
+        size_t aln_count = 0;
+        vector<AlignmentInfo> align_batch;
+        vector<string> contig_batch;
+        auto addRead = [&](size_t read_index, const string &seq) {
+            for (size_t i = read_alignments[read_index].first; i < read_alignments[read_index].second; i++) {
+                AlignmentStreamRecord rec = stream[i];
+                AlignmentInfo aln;
+                aln.read_id = stream.readId(read_index);
+                aln.contig_id = stream.contigId(rec.contig_index);
+                aln.read_start = rec.read_start;
+                aln.read_end = rec.read_end;
+                aln.alignment_start = rec.contig_start;
+                aln.alignment_end = rec.contig_end;
+                aln.rc = rec.rc != 0;
+                align_batch.push_back(std::move(aln));
+                contig_batch.push_back(seq);
+                aln_count ++;
+            }
+            found[read_index] = true;
+            found_count++;
+            if (align_batch.size() >= BATCH_SIZE) {
+                logger.trace() << "Batch of size " << align_batch.size() <<" created, processing" << endl;
+                processBatch(logger, contig_batch, align_batch);
+                logger.trace() << "Processed " << aln_count << " compressed mappings " << endl;
+                contig_batch.resize(0);
+                align_batch.resize(0);
+            }
+        };
+        logger.info() << "Reading and processing initial reads from " << lib << "\n";
+        size_t next = 0;
+        size_t reads_count = 0;
+        io::ReadLibrary(lib, [&](auto begin, auto end) {
+            for (; begin != end && next < stream.readNum(); ++begin) {
+                auto &&read = *begin;
+                reads_count ++;
+                if (reads_count % 1000 == 0) {
+                    logger.trace() << "Processed " << reads_count << " original reads " << endl;
+                }
+                if (clippedId(read) == stream.readId(next)) {
+                    addRead(next, readSequence(read));
+                    next++;
+                }
+            }
+        });
+        if (found_count < stream.readNum()) {
+            logger.info() << stream.readNum() - found_count << " aligned reads were not found in alignment order. "
+                          << "Looking them up by name\n";
+            std::unordered_multimap<string, size_t> missing;
+            for (size_t i = 0; i < stream.readNum(); i++) {
+                if (!found[i])
+                    missing.emplace(stream.readId(i), i);
+            }
+            io::ReadLibrary(lib, [&](auto begin, auto end) {
+                for (; begin != end && !missing.empty(); ++begin) {
+                    auto &&read = *begin;
+                    auto it = missing.find(clippedId(read));
+                    if (it == missing.end())
+                        continue;
+                    addRead(it->second, readSequence(read));
+                    missing.erase(it);
+                }
+            });
+            if (!missing.empty())
+                logger.info() << "Reads are over. " << missing.size() << " aligned reads were not found\n";
+        }
+        processBatch(logger, contig_batch, align_batch);
+        logger.trace() << "Processed final batch of " << align_batch.size() << " compressed reads " << endl;
+        return generateConsensus(logger);
+    }
+
+    vector<Contig> generateConsensus(logging::Logger &logger) {
         vector<Contig> res;
         logger.info() << "Uncompressing homopolymers in contigs" << endl;
         for (auto& contig: contigs){
@@ -743,8 +939,11 @@ std::vector<Contig> Polish(logging::Logger &logger, size_t threads,
                                            const std::vector<Contig> &contigs,
                                            const std::experimental::filesystem::path &alignments,
                                            const io::Library &reads, size_t dicompress) {
+    logging::StageTimer timer("Polish");
     omp_set_num_threads(threads);
     AssemblyInfo assemblyInfo(logger, contigs, dicompress);
+    if (AlignmentStream::IsStream(alignments))
+        return std::move(assemblyInfo.processStream(logger, reads, alignments));
     return std::move(assemblyInfo.process(logger, reads, alignments));
 }
 
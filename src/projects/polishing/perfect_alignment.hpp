@@ -1,6 +1,10 @@
 #include <common/omp_utils.hpp>
+#include "alignment_stream.hpp"
 #include "sequences/contigs.hpp"
 #include "common/rolling_hash.hpp"
+#include "common/string_utils.hpp"
+#include <parallel/algorithm>
+#include <tuple>
 struct RawSeg {
     std::string id;
     size_t left;
@@ -42,6 +46,87 @@ bool operator<(const AlignmentRecord &al1, const AlignmentRecord &al2) {
     return al1.seg_to < al2.seg_to;
 }
 
+//Index of every w-th k-mer of contigs. Entries are kept in one array sorted by bucket and hash. Bucket is given by the top
+//bits of mixed hash and there are about as many buckets as entries, so lookup reads two bucket boundaries and scans a
+//couple of neighbouring entries instead of following hash map chains.
+class ContigKmerIndex {
+public:
+    struct Entry {
+        hashing::htype hash;
+        Contig *contig;
+        size_t pos;
+    };
+
+private:
+    std::vector<Entry> entries;
+    std::vector<size_t> bucket_starts;
+    size_t bucket_bits = 0;
+
+    size_t bucket(hashing::htype h) const {
+        uint64_t mixed = (uint64_t(h) ^ uint64_t(h >> 64u)) * 0x9E3779B97F4A7C15ull;
+        return bucket_bits == 0 ? 0 : size_t(mixed >> (64 - bucket_bits));
+    }
+
+public:
+    ContigKmerIndex(const hashing::RollingHash &hasher, std::vector<Contig> &contigs, size_t w, size_t threads) {
+        size_t k = hasher.getK();
+        std::vector<size_t> offsets = {0};
+        for(Contig &contig : contigs) {
+            size_t cnt = contig.size() >= k + 1 ? (contig.size() - k - 1) / w + 1 : 0;
+            offsets.push_back(offsets.back() + cnt);
+        }
+        entries.resize(offsets.back());
+        omp_set_num_threads(threads);
+#pragma omp parallel for schedule(dynamic, 1) default(none) shared(contigs, offsets, hasher, w, k)
+        for(size_t i = 0; i < contigs.size(); i++) {
+            Entry *next = &entries[offsets[i]];
+            for(size_t pos = 1; pos + k <= contigs[i].size(); pos += w) {
+                *next = {hasher.hash(contigs[i].seq, pos), &contigs[i], pos};
+                ++next;
+            }
+        }
+        while((size_t(1) << bucket_bits) < entries.size())
+            bucket_bits++;
+        __gnu_parallel::sort(entries.begin(), entries.end(), [this](const Entry &e1, const Entry &e2) {
+            size_t b1 = bucket(e1.hash);
+            size_t b2 = bucket(e2.hash);
+            if(b1 != b2)
+                return b1 < b2;
+            if(e1.hash != e2.hash)
+                return e1.hash < e2.hash;
+            if(e1.contig != e2.contig)
+                return e1.contig < e2.contig;
+            return e1.pos < e2.pos;
+        });
+        bucket_starts.resize((size_t(1) << bucket_bits) + 1);
+        size_t cur = 0;
+        for(size_t b = 0; b < bucket_starts.size(); b++) {
+            while(cur < entries.size() && bucket(entries[cur].hash) < b)
+                cur++;
+            bucket_starts[b] = cur;
+        }
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+//    Returns the range of entries with the given hash
+    std::pair<const Entry *, const Entry *> find(hashing::htype h) const {
+        size_t b = bucket(h);
+        const Entry *from = entries.data() + bucket_starts[b];
+        const Entry *to = entries.data() + bucket_starts[b + 1];
+        while(from != to && from->hash != h)
+            ++from;
+        const Entry *res_end = from;
+        while(res_end != to && res_end->hash == h)
+            ++res_end;
+        return {from, res_end};
+    }
+};
+
+//Finds all exact matches of length more than K between reads and contigs. Every such match contains a k-mer from the
+//index so k-mer hits are grouped by diagonal and each match is extended only once starting from its first hit.
 template<class I>
 std::vector<AlignmentRecord> RealignReads(logging::Logger &logger, size_t threads, std::vector<Contig> &contigs, I read_start, I read_end,
                                           size_t K) {
@@ -49,45 +134,36 @@ std::vector<AlignmentRecord> RealignReads(logging::Logger &logger, size_t thread
     size_t k = K / 2;
     size_t w = K - k;
     hashing::RollingHash hasher(k, 239);
-    std::unordered_map<hashing::htype, std::vector<std::pair<Contig *, size_t>>, hashing::alt_hasher<hashing::htype>> position_map;
-    for(Contig &contig : contigs) {
-        for(size_t pos = 1; pos + k <= contig.size(); pos += w) {
-            hashing::htype h = hasher.hash(contig.seq, pos);
-            position_map[h].emplace_back(&contig, pos);
-        }
-    }
+    ContigKmerIndex index(hasher, contigs, w, threads);
+    logger.trace() << "Indexed " << index.size() << " contig k-mers" << std::endl;
     ParallelRecordCollector<AlignmentRecord> result(threads);
-    std::function<void(size_t,StringContig)> task = [&result, &hasher, &position_map, K](size_t num, StringContig contig) {
+    std::function<void(size_t,StringContig)> task = [&result, &hasher, &index, K](size_t num, StringContig contig) {
         Contig read = contig.makeContig();
-        std::vector<std::pair<Contig *, int>> res;
-        hashing::KWH kwh(hasher, read.seq, 0);
-        while (true) {
-            if (position_map.find(kwh.fHash()) != position_map.end()) {
-                for(std::pair<Contig *, size_t> &pos : position_map[kwh.fHash()]) {
-                    int start_pos = int(pos.second) - int(kwh.pos);
-                    res.emplace_back(pos.first, start_pos);
-                }
+        std::vector<std::tuple<Contig *, int, size_t>> hits;
+        hashing::KmerHashBuffer kmers(hasher, read.seq);
+        for (size_t kpos = 0; kpos < kmers.size(); kpos++) {
+            std::pair<const ContigKmerIndex::Entry *, const ContigKmerIndex::Entry *> range = index.find(kmers.fHash(kpos));
+            for(const ContigKmerIndex::Entry *it = range.first; it != range.second; ++it) {
+                hits.emplace_back(it->contig, int(it->pos) - int(kpos), kpos);
             }
-            if (!kwh.hasNext())
-                break;
-            kwh = kwh.next();
         }
-        std::sort(res.begin(), res.end());
-        res.erase(std::unique(res.begin(), res.end()), res.end());
-        for(std::pair<Contig *, int> &al : res) {
-            size_t clen = 0;
-            for(int rpos = 0; rpos <= read.size(); rpos++) {
-                if(rpos < read.size() && rpos + al.second >= 0 && rpos + al.second < al.first->size() &&
-                         read.seq[rpos] == al.first->seq[rpos + al.second]) {
-                    clen++;
-                } else {
-                    if(clen > K) {
-                        RawSeg seg_from(read.getId(), rpos - clen, rpos);
-                        Segment<Contig> seg_to(*al.first, rpos + al.second - clen, rpos + al.second);
-                        result.emplace_back(read.size(), num, seg_from, seg_to);
-                    }
-                    clen = 0;
-                }
+        std::sort(hits.begin(), hits.end());
+        size_t covered_until = 0;
+        for(size_t i = 0; i < hits.size(); i++) {
+            Contig &target = *std::get<0>(hits[i]);
+            int diag = std::get<1>(hits[i]);
+            size_t kpos = std::get<2>(hits[i]);
+            if(i == 0 || std::get<0>(hits[i - 1]) != &target || std::get<1>(hits[i - 1]) != diag)
+                covered_until = 0;
+            if(kpos < covered_until || read.seq[kpos] != target.seq[kpos + diag])
+                continue;
+            size_t left = kpos - read.seq.Subseq(0, kpos).commonSuffix(target.seq.Subseq(0, kpos + diag));
+            size_t right = kpos + read.seq.Subseq(kpos).commonPrefix(target.seq.Subseq(kpos + diag));
+            covered_until = right;
+            if(right - left > K) {
+                RawSeg seg_from(read.getId(), left, right);
+                Segment<Contig> seg_to(target, left + diag, right + diag);
+                result.emplace_back(read.size(), num, seg_from, seg_to);
             }
         }
     };
@@ -109,12 +185,17 @@ std::pair<std::experimental::filesystem::path, std::experimental::filesystem::pa
         contigsAndRC.emplace_back(contig.RC());
     }
     std::vector<AlignmentRecord> final = RealignReads(logger, threads, contigsAndRC, read_start, read_end, K);
-    logger.info() << "Printing alignments to " << (dir/"alignments.txt") << std::endl;
-    std::experimental::filesystem::path good_fname = dir/"good_alignments.txt";
+    logger.info() << "Printing alignments to " << (dir/"good_alignments.bin") << std::endl;
+    std::experimental::filesystem::path good_fname = dir/"good_alignments.bin";
     std::experimental::filesystem::path bad_fname = dir/"partial_alignments.txt";
-    std::ofstream os;
+    std::vector<std::string> contig_ids;
+    for(const Contig & contig : contigs) {
+        contig_ids.emplace_back(contig.getId());
+    }
+    std::vector<std::string> read_ids;
+    std::vector<AlignmentStreamRecord> good;
+    size_t last_read = size_t(-1);
     std::ofstream os_bad;
-    os.open(good_fname);
     os_bad.open(bad_fname);
     for(auto &rec : final) {
         size_t len = rec.contig_len;
@@ -124,12 +205,24 @@ std::pair<std::experimental::filesystem::path, std::experimental::filesystem::pa
                    << rec.seg_to.contig().getId() << " " << rec.seg_to.left << " " << rec.seg_to.right
                    << "\n";
         } else {
-            os << rec.seg_from.id << " " << rec.seg_from.left << " " << rec.seg_from.right << " "
-               << rec.seg_to.contig().getId() << " " << rec.seg_to.left << " " << rec.seg_to.right
-               << "\n";
+            if(rec.readIntId != last_read) {
+                last_read = rec.readIntId;
+                read_ids.emplace_back(split(rec.seg_from.id)[0]);
+            }
+            size_t contig_index = &rec.seg_to.contig() - contigsAndRC.data();
+            AlignmentStreamRecord aln{};
+            aln.read_index = read_ids.size() - 1;
+            aln.contig_index = contig_index / 2;
+            aln.read_start = rec.seg_from.left;
+            aln.read_end = rec.seg_from.right;
+            aln.contig_start = rec.seg_to.left;
+            aln.contig_end = rec.seg_to.right;
+            aln.rc = contig_index % 2;
+            aln.read_ordinal = uint32_t(rec.readIntId);
+            good.push_back(aln);
         }
     }
-    os.close();
     os_bad.close();
+    AlignmentStream::Write(good_fname, contig_ids, read_ids, good);
     return {good_fname, bad_fname};
-}
\ No newline at end of file
+}
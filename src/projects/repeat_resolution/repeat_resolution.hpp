@@ -43,14 +43,15 @@ class RepeatResolver {
                    uint64_t unique_threshold,
                    bool diploid,
                    bool debug,
-                   logging::Logger &logger)
+                   logging::Logger &logger,
+                   size_t threads)
         : dbg{dbg}, reads_storage{std::move(reads_storage)},
           extra_storages{std::move(extra_storages)}, start_k{start_k},
           saturating_k{saturating_k}, dir{std::move(dir)},
           unique_threshold{unique_threshold}, diploid{diploid}, debug{debug},
           classificator{dbg, *(this->reads_storage), diploid, debug} {
         std::experimental::filesystem::create_directory(this->dir);
-        classificator.classify(logger, unique_threshold, dir/"mult_dir");
+        classificator.classify(logger, threads, unique_threshold, dir/"mult_dir");
         // TODO reactivate filtering
 //        for (RecordStorage *const storage : get_storages()) {
 //            storage->invalidateSubreads(logger, 1);
@@ -58,6 +59,7 @@ class RepeatResolver {
     }
 
     void ResolveRepeats(logging::Logger &logger, size_t threads) {
+        logging::StageTimer timer("ResolveRepeats");
         logger.info() << "Resolving repeats" << std::endl;
         logger.info() << "Constructing paths" << std::endl;
         RRPaths rr_paths = PathsBuilder::FromDBGStorages(dbg, get_storages());
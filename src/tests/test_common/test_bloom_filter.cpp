@@ -0,0 +1,25 @@
+#include "gtest/gtest.h"
+#include "common/bloom_filter.hpp"
+#include "common/hash_utils.hpp"
+#include <random>
+
+using namespace hashing;
+
+TEST(BlockedBloomFilterTest, NoFalseNegatives) {
+    std::mt19937_64 gen(5);
+    std::vector<htype> values;
+    for(size_t i = 0; i < 100000; i++)
+        values.push_back(htype(gen()) << 64u | gen());
+    BlockedBloomFilter filter(values.size(), 0.0001);
+#pragma omp parallel for num_threads(4)
+    for(size_t i = 0; i < values.size(); i++)
+        filter.insert(values[i]);
+    for(const htype &value : values)
+        ASSERT_TRUE(filter.contains(value));
+    size_t false_positives = 0;
+    for(size_t i = 0; i < 100000; i++) {
+        if(filter.contains(htype(gen()) << 64u | gen()))
+            false_positives++;
+    }
+    ASSERT_LT(false_positives, 100u);
+}
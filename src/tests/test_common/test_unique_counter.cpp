@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+#include "common/omp_utils.hpp"
+#include "common/hash_utils.hpp"
+#include <map>
+#include <numeric>
+#include <random>
+
+using namespace hashing;
+
+TEST(ParallelUniqueCounterTest, MatchesMap) {
+    std::mt19937_64 gen(17);
+    size_t threads = 4;
+//    Small shards and buffers make tables grow many times and flush from every thread
+    ParallelUniqueCounter<htype, alt_hasher<htype>> counter(threads, 2, 16);
+    std::vector<std::vector<htype>> values(threads);
+    std::map<htype, size_t> expected;
+    for(size_t i = 0; i < 100000; i++) {
+//        About half of the values repeat
+        htype value = htype(gen() % 50000) << 64u | (gen() % 3);
+        values[i % threads].push_back(value);
+        expected[value]++;
+    }
+#pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for(size_t i = 0; i < threads; i++)
+        counter.addAll(values[i].begin(), values[i].end());
+    counter.flushAll();
+    ASSERT_EQ(counter.size(), expected.size());
+    std::vector<size_t> shard_sizes = counter.shardSizes();
+    ASSERT_EQ(shard_sizes.size(), 4u);
+    ASSERT_EQ(std::accumulate(shard_sizes.begin(), shard_sizes.end(), size_t(0)), expected.size());
+    std::vector<size_t> hist = counter.histogram(3);
+    std::vector<size_t> expected_hist(4, 0);
+    for(const std::pair<const htype, size_t> &it : expected)
+        expected_hist[std::min<size_t>(it.second, 3)]++;
+    ASSERT_EQ(hist, expected_hist);
+    std::vector<htype> sorted = counter.collectSorted();
+    ASSERT_EQ(sorted.size(), expected.size());
+    size_t i = 0;
+    for(const std::pair<const htype, size_t> &it : expected) {
+        ASSERT_TRUE(sorted[i] == it.first);
+        i++;
+    }
+    ASSERT_EQ(counter.size(), 0u);
+}
+
+TEST(ParallelUniqueCounterTest, MinCountDropsRareValues) {
+    std::mt19937_64 gen(19);
+    size_t threads = 4;
+    ParallelUniqueCounter<htype, alt_hasher<htype>> counter(threads, 2, 16);
+    std::vector<std::vector<htype>> values(threads);
+    std::map<htype, size_t> expected;
+    for(size_t i = 0; i < 50000; i++) {
+        htype value = htype(gen() % 20000) << 64u;
+        values[i % threads].push_back(value);
+        expected[value]++;
+    }
+#pragma omp parallel for num_threads(threads) schedule(static, 1)
+    for(size_t i = 0; i < threads; i++)
+        counter.addAll(values[i].begin(), values[i].end());
+    counter.flushAll();
+    std::vector<htype> sorted = counter.collectSorted(2);
+    std::vector<htype> repeated;
+    for(const std::pair<const htype, size_t> &it : expected)
+        if(it.second >= 2)
+            repeated.push_back(it.first);
+//    Both singletons and repeated values must be present for the filter to be tested
+    ASSERT_LT(repeated.size(), expected.size());
+    ASSERT_GT(repeated.size(), 0u);
+    ASSERT_TRUE(sorted == repeated);
+    ASSERT_EQ(counter.size(), 0u);
+}
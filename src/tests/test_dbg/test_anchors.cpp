@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+#include "dbg/dbg_construction.hpp"
+#include <random>
+
+using namespace dbg;
+
+namespace {
+//    Random genome with a few copies of a repeat so that the graph has junctions and edges of different lengths
+    Sequence RandomGenome(std::mt19937 &gen, size_t size, size_t repeat_size) {
+        std::vector<unsigned char> repeat(repeat_size);
+        for(unsigned char &c : repeat)
+            c = gen() % 4;
+        std::vector<unsigned char> res;
+        while(res.size() < size) {
+            size_t unique_len = 500 + gen() % 5000;
+            for(size_t i = 0; i < unique_len; i++)
+                res.push_back(gen() % 4);
+            res.insert(res.end(), repeat.begin(), repeat.end());
+        }
+        return Sequence(res);
+    }
+
+//    Every k-mer that the old implementation sampled from a full KmerHashBuffer of the edge must be an anchor that
+//    points to the same k-mer
+    void CheckAnchors(SparseDBG &dbg, size_t w) {
+        size_t checked = 0;
+        for(Edge &edge : dbg.edges()) {
+            if(edge.size() <= w)
+                continue;
+            hashing::KmerHashBuffer kmers(dbg.hasher(), edge.start()->seq + edge.seq);
+            for(size_t pos = w; pos + 1 < kmers.size(); pos += w) {
+                hashing::KWH kwh = kmers.kwh(pos);
+                ASSERT_TRUE(dbg.isAnchor(kwh.hash()));
+                EdgePosition anchor = dbg.getAnchor(kwh);
+                ASSERT_EQ(anchor.kmerSeq(), kwh.getSeq());
+                checked++;
+            }
+        }
+        ASSERT_GT(checked, 0u);
+    }
+}
+
+TEST(SparseDBGTest, FillAnchorsSamplesEdgeKmers) {
+    std::mt19937 gen(11);
+    logging::Logger logger;
+    size_t k = 31;
+    hashing::RollingHash hasher(k, 239);
+    std::vector<Sequence> disjointigs = {RandomGenome(gen, 50000, 200)};
+    std::vector<hashing::htype> vertices = findJunctions(logger, disjointigs, hasher, 1);
+    ASSERT_FALSE(vertices.empty());
+//    Strides shorter and longer than k use rolling and direct hashing
+    for(size_t w : {7u, 31u, 100u}) {
+        SparseDBG dbg = constructDBG(logger, vertices, disjointigs, hasher, 1);
+        dbg.fillAnchors(w, logger, 1);
+        ASSERT_NO_FATAL_FAILURE(CheckAnchors(dbg, w));
+        dbg.clearAnchors();
+        dbg.fillAnchors(w, logger, 1, {});
+        ASSERT_NO_FATAL_FAILURE(CheckAnchors(dbg, w));
+    }
+}
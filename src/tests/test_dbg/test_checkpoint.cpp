@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+#include "dbg/dbg_construction.hpp"
+#include "dbg/graph_checkpoint.hpp"
+#include <map>
+#include <random>
+#include <unistd.h>
+
+using namespace dbg;
+
+namespace {
+    Sequence RandomGenome(std::mt19937 &gen, size_t size, size_t repeat_size) {
+        std::vector<unsigned char> repeat(repeat_size);
+        for(unsigned char &c : repeat)
+            c = gen() % 4;
+        std::vector<unsigned char> res;
+        while(res.size() < size) {
+            size_t unique_len = 500 + gen() % 3000;
+            for(size_t i = 0; i < unique_len; i++)
+                res.push_back(gen() % 4);
+            res.insert(res.end(), repeat.begin(), repeat.end());
+        }
+        return Sequence(res);
+    }
+
+    std::map<std::string, size_t> EdgeCoverages(SparseDBG &dbg) {
+        std::map<std::string, size_t> res;
+        for(Edge &edge : dbg.edges())
+            res[(edge.start()->seq + edge.seq).str()] = edge.intCov();
+        return res;
+    }
+}
+
+TEST(DBGCheckpointTest, RoundTripKeepsVertexStore) {
+    std::mt19937 gen(5);
+    logging::Logger logger;
+    hashing::RollingHash hasher(31, 239);
+    std::vector<Sequence> disjointigs = {RandomGenome(gen, 30000, 200)};
+    std::vector<hashing::htype> vertices = findJunctions(logger, disjointigs, hasher, 1);
+    std::experimental::filesystem::path fname = std::experimental::filesystem::temp_directory_path() /
+            ("checkpoint_test_" + std::to_string(getpid()) + ".bin");
+    for(bool perfect : {false, true}) {
+        SparseDBG dbg = constructDBG(logger, vertices, disjointigs, hasher, 1, perfect);
+        for(Edge &edge : dbg.edges())
+            edge.incCov(edge.size() % 7);
+        ASSERT_EQ(dbg.hasPerfectVertexIndex(), perfect);
+        DBGCheckpoint::Save(fname, dbg, 100, 17);
+        ASSERT_TRUE(DBGCheckpoint::Check(fname, hasher, 100, 17));
+//        Checkpoint of other window, inputs or hasher is not reused
+        ASSERT_FALSE(DBGCheckpoint::Check(fname, hasher, 200, 17));
+        ASSERT_FALSE(DBGCheckpoint::Check(fname, hasher, 100, 18));
+        ASSERT_FALSE(DBGCheckpoint::Check(fname, hashing::RollingHash(31, 241), 100, 17));
+        ASSERT_FALSE(DBGCheckpoint::Check(fname, hashing::RollingHash(33, 239), 100, 17));
+        SparseDBG loaded = DBGCheckpoint::Load(fname, hasher, logger, 1);
+        ASSERT_EQ(loaded.hasPerfectVertexIndex(), perfect);
+        ASSERT_EQ(loaded.size(), dbg.size());
+        ASSERT_EQ(EdgeCoverages(loaded), EdgeCoverages(dbg));
+    }
+    std::experimental::filesystem::remove(fname);
+}
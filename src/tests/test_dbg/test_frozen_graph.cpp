@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "dbg/dbg_construction.hpp"
+#include "dbg/frozen_graph.hpp"
+#include <map>
+#include <random>
+
+using namespace dbg;
+
+namespace {
+    Sequence RandomGenome(std::mt19937 &gen, size_t size, size_t repeat_size) {
+        std::vector<unsigned char> repeat(repeat_size);
+        for(unsigned char &c : repeat)
+            c = gen() % 4;
+        std::vector<unsigned char> res;
+        while(res.size() < size) {
+            size_t unique_len = 300 + gen() % 2000;
+            for(size_t i = 0; i < unique_len; i++)
+                res.push_back(gen() % 4);
+            res.insert(res.end(), repeat.begin(), repeat.end());
+        }
+        return Sequence(res);
+    }
+
+    void CheckSameAlignment(const GraphAlignment &expected, const GraphAlignment &actual) {
+        ASSERT_EQ(actual.size(), expected.size());
+        if(expected.size() == 0)
+            return;
+        ASSERT_EQ(&actual.start(), &expected.start());
+        for(size_t i = 0; i < expected.size(); i++) {
+            ASSERT_EQ(&actual[i].contig(), &expected[i].contig());
+            ASSERT_EQ(actual[i].left, expected[i].left);
+            ASSERT_EQ(actual[i].right, expected[i].right);
+        }
+    }
+}
+
+TEST(FrozenGraphTest, MatchesSourceGraph) {
+    std::mt19937 gen(13);
+    logging::Logger logger;
+    size_t k = 31;
+    size_t w = 50;
+    hashing::RollingHash hasher(k, 239);
+    Sequence genome = RandomGenome(gen, 40000, 150);
+    std::vector<Sequence> disjointigs = {genome, !genome.Subseq(1000, 9000)};
+    std::vector<hashing::htype> vertices = findJunctions(logger, disjointigs, hasher, 1);
+    SparseDBG dbg = constructDBG(logger, vertices, disjointigs, hasher, 1);
+    dbg.fillAnchors(w, logger, 1);
+    std::map<const Edge *, std::string> edge_seqs;
+    std::map<const Vertex *, std::string> vertex_seqs;
+    for(Vertex &vertex : dbg.vertices()) {
+        vertex_seqs[&vertex] = vertex.seq.str();
+        for(Edge &edge : vertex)
+            edge_seqs[&edge] = edge.seq.str();
+    }
+    FrozenGraph frozen(dbg, 2);
+    ASSERT_EQ(frozen.vertexCount(), vertex_seqs.size());
+    ASSERT_EQ(frozen.edgeCount(), edge_seqs.size());
+//    Source graph keeps the same sequences after they are moved to the arena
+    for(Vertex &vertex : dbg.vertices()) {
+        ASSERT_EQ(vertex.seq.str(), vertex_seqs[&vertex]);
+        for(Edge &edge : vertex)
+            ASSERT_EQ(edge.seq.str(), edge_seqs[&edge]);
+    }
+    for(FrozenGraph::id_type v = 0; v < frozen.vertexCount(); v++) {
+        Vertex &vertex = frozen.vertex(v);
+        ASSERT_EQ(frozen.vertexId(vertex), v);
+        ASSERT_EQ(&frozen.vertex(frozen.rcVertex(v)), &vertex.rc());
+        ASSERT_EQ(frozen.outDeg(v), vertex.outDeg());
+        ASSERT_EQ(frozen.inDeg(v), vertex.inDeg());
+        ASSERT_EQ(frozen.vertexSeq(v), vertex.seq);
+        for(FrozenGraph::id_type e = frozen.firstOutgoing(v); e < frozen.lastOutgoing(v); e++) {
+            Edge &edge = frozen.edge(e);
+            ASSERT_EQ(edge.start(), &vertex);
+            ASSERT_EQ(&frozen.vertex(frozen.end(e)), edge.end());
+            ASSERT_EQ(&frozen.edge(frozen.rcEdge(e)), &edge.rc());
+            ASSERT_EQ(frozen.rcEdge(frozen.rcEdge(e)), e);
+            ASSERT_EQ(frozen.fullSeq(e), vertex.seq + edge.seq);
+            ASSERT_EQ(frozen.size(e), edge.size());
+            ASSERT_EQ(frozen.isCanonicalEdge(e), vertex.isCanonical(edge));
+            ASSERT_EQ(frozen.oldId(e), edge.oldId());
+        }
+    }
+    GraphAligner aligner(dbg);
+//    Pieces of the genome in both directions. Every piece is long enough to contain a vertex or an anchor, and short
+//    ones often contain no vertex and are aligned through anchors.
+    for(size_t i = 0; i < 300; i++) {
+        size_t len = k + w + (i % 3 == 0 ? gen() % 100 : gen() % 3000);
+        size_t pos = gen() % (genome.size() - len);
+        Sequence seq = genome.Subseq(pos, pos + len);
+        if(i % 2 == 1)
+            seq = !seq;
+        ASSERT_NO_FATAL_FAILURE(CheckSameAlignment(aligner.align(seq), frozen.align(seq)));
+    }
+}
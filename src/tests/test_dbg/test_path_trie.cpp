@@ -0,0 +1,186 @@
+#include "gtest/gtest.h"
+#include "dbg/path_trie.hpp"
+#include <map>
+#include <random>
+
+using namespace dbg;
+
+namespace {
+//    Old VertexRecord representation: one entry per distinct path, every query scans all entries
+    struct NaivePaths {
+        std::vector<std::pair<Sequence, size_t>> paths;
+
+        void add(const Sequence &seq) {
+            for(std::pair<Sequence, size_t> &path : paths) {
+                if(path.first == seq) {
+                    path.second++;
+                    return;
+                }
+            }
+            paths.emplace_back(seq, 1);
+        }
+
+        bool remove(const Sequence &seq) {
+            for(std::pair<Sequence, size_t> &path : paths) {
+                if(path.first == seq && path.second > 0) {
+                    path.second--;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        size_t countStartsWith(const Sequence &seq) const {
+            size_t cnt = 0;
+            for(const std::pair<Sequence, size_t> &path : paths) {
+                if(path.first.startsWith(seq))
+                    cnt += path.second;
+            }
+            return cnt;
+        }
+
+        std::map<std::string, size_t> contents() const {
+            std::map<std::string, size_t> res;
+            for(const std::pair<Sequence, size_t> &path : paths) {
+                if(path.second > 0)
+                    res[path.first.str()] = path.second;
+            }
+            return res;
+        }
+    };
+
+    std::map<std::string, size_t> Contents(const PathTrie &trie) {
+        std::map<std::string, size_t> res;
+        trie.forEach([&res](const Sequence &path, size_t cnt) {
+            EXPECT_EQ(res.count(path.str()), 0u);
+            res[path.str()] = cnt;
+        });
+        return res;
+    }
+
+    Sequence RandomPath(std::mt19937 &gen, size_t max_len) {
+        std::vector<unsigned char> nucls(gen() % (max_len + 1));
+//        Small alphabet for the first nucleotides makes paths share prefixes of different lengths
+        for(size_t i = 0; i < nucls.size(); i++)
+            nucls[i] = i < 3 ? gen() % 2 : gen() % 4;
+        return Sequence(nucls);
+    }
+
+    void CheckAgainstNaive(const PathTrie &trie, const NaivePaths &naive, const Sequence &query) {
+        ASSERT_EQ(trie.countStartsWith(query), naive.countStartsWith(query));
+        std::array<size_t, 4> ext = trie.countExtensions(query);
+        for(unsigned char c = 0; c < 4; c++) {
+            ASSERT_EQ(ext[c], naive.countStartsWith(query + Sequence(std::vector<unsigned char>{c})));
+        }
+//        Cursor moved along the query one nucleotide at a time gives the same counts as the query itself
+        PathTrie::Cursor cursor = trie.find(Sequence());
+        for(size_t i = 0; i < query.size(); i++)
+            trie.advance(cursor, query[i]);
+        ASSERT_EQ(trie.countExtensions(cursor), ext);
+    }
+}
+
+TEST(PathTrieTest, SplitOnPartialMatch) {
+    PathTrie trie;
+    trie.add(Sequence("ACGTACGT"));
+    ASSERT_EQ(trie.nodeCount(), 2u);
+    trie.add(Sequence("ACGTTT"));
+    ASSERT_EQ(trie.nodeCount(), 4u);
+//    Path ending in the middle of a label splits it without adding a branch
+    trie.add(Sequence("ACG"));
+    ASSERT_EQ(trie.nodeCount(), 5u);
+    trie.add(Sequence("ACG"));
+    ASSERT_EQ(trie.nodeCount(), 5u);
+    ASSERT_EQ(trie.size(), 4u);
+    ASSERT_EQ(trie.countStartsWith(Sequence("AC")), 4u);
+    ASSERT_EQ(trie.countStartsWith(Sequence("ACGT")), 2u);
+    ASSERT_EQ(trie.countStartsWith(Sequence("ACGTA")), 1u);
+    ASSERT_EQ(trie.countStartsWith(Sequence("ACGTG")), 0u);
+    ASSERT_EQ(trie.countStartsWith(Sequence("ACGTACGTA")), 0u);
+    std::array<size_t, 4> ext = trie.countExtensions(Sequence("ACGT"));
+    ASSERT_EQ(ext[0], 1u);
+    ASSERT_EQ(ext[1], 0u);
+    ASSERT_EQ(ext[2], 0u);
+    ASSERT_EQ(ext[3], 1u);
+    ext = trie.countExtensions(Sequence("ACGTAC"));
+    ASSERT_EQ(ext[2], 1u);
+    std::map<std::string, size_t> expected = {{"ACG", 2}, {"ACGTACGT", 1}, {"ACGTTT", 1}};
+    ASSERT_EQ(Contents(trie), expected);
+}
+
+TEST(PathTrieTest, RemoveMerges) {
+    PathTrie trie;
+    trie.add(Sequence("ACGTACGT"));
+    trie.add(Sequence("ACGTTT"));
+    trie.add(Sequence("ACG"));
+    ASSERT_EQ(trie.nodeCount(), 5u);
+    ASSERT_FALSE(trie.remove(Sequence("ACGT")));
+    ASSERT_FALSE(trie.remove(Sequence("ACGTT")));
+    ASSERT_EQ(trie.size(), 3u);
+//    ACG is left without ending paths and with two children so it stays
+    ASSERT_TRUE(trie.remove(Sequence("ACG")));
+    ASSERT_EQ(trie.nodeCount(), 4u);
+//    Removing a branch leaves ACGT with one child and it is merged back into one label
+    ASSERT_TRUE(trie.remove(Sequence("ACGTTT")));
+    ASSERT_EQ(trie.nodeCount(), 2u);
+    ASSERT_EQ(trie.countStartsWith(Sequence("ACGTA")), 1u);
+    std::map<std::string, size_t> expected = {{"ACGTACGT", 1}};
+    ASSERT_EQ(Contents(trie), expected);
+    ASSERT_FALSE(trie.remove(Sequence("ACGTTT")));
+    ASSERT_TRUE(trie.remove(Sequence("ACGTACGT")));
+    ASSERT_EQ(trie.size(), 0u);
+    ASSERT_EQ(trie.nodeCount(), 0u);
+    ASSERT_EQ(trie.countStartsWith(Sequence()), 0u);
+}
+
+TEST(PathTrieTest, FreeListReuse) {
+    PathTrie trie;
+    trie.add(Sequence("AAAA"));
+    trie.add(Sequence("AACC"));
+    trie.add(Sequence("AAGG"));
+    trie.add(Sequence("AATT"));
+    size_t capacity = trie.nodeCapacity();
+    ASSERT_EQ(trie.nodeCount(), 6u);
+    ASSERT_TRUE(trie.remove(Sequence("AACC")));
+    ASSERT_TRUE(trie.remove(Sequence("AAGG")));
+    ASSERT_EQ(trie.nodeCount(), 4u);
+    trie.add(Sequence("AAGC"));
+    trie.add(Sequence("AACG"));
+    ASSERT_EQ(trie.nodeCount(), 6u);
+    ASSERT_EQ(trie.nodeCapacity(), capacity);
+    for(size_t i = 0; i < 100; i++) {
+        ASSERT_TRUE(trie.remove(Sequence("AAGC")));
+        trie.add(Sequence("AAGCT"));
+        ASSERT_TRUE(trie.remove(Sequence("AAGCT")));
+        trie.add(Sequence("AAGC"));
+    }
+    ASSERT_EQ(trie.nodeCapacity(), capacity);
+}
+
+TEST(PathTrieTest, RandomAgainstVectorScan) {
+    std::mt19937 gen(7);
+    for(size_t iter = 0; iter < 20; iter++) {
+        PathTrie trie;
+        NaivePaths naive;
+        std::vector<Sequence> added;
+        for(size_t step = 0; step < 500; step++) {
+            if(added.empty() || gen() % 3 != 0) {
+                Sequence path = RandomPath(gen, 12);
+                trie.add(path);
+                naive.add(path);
+                added.push_back(path);
+            } else {
+//                Mostly remove stored paths but also try paths that may be absent
+                Sequence path = gen() % 4 == 0 ? RandomPath(gen, 12) : added[gen() % added.size()];
+                ASSERT_EQ(trie.remove(path), naive.remove(path));
+            }
+            ASSERT_NO_FATAL_FAILURE(CheckAgainstNaive(trie, naive, RandomPath(gen, 6)));
+            if(!added.empty()) {
+                const Sequence &path = added[gen() % added.size()];
+                ASSERT_NO_FATAL_FAILURE(CheckAgainstNaive(trie, naive, path.Subseq(0, gen() % (path.size() + 1))));
+            }
+        }
+        ASSERT_EQ(Contents(trie), naive.contents());
+        ASSERT_EQ(trie.size(), naive.countStartsWith(Sequence()));
+    }
+}
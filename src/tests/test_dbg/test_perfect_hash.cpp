@@ -0,0 +1,180 @@
+#include "gtest/gtest.h"
+#include "common/perfect_hash.hpp"
+#include "dbg/sparse_dbg.hpp"
+#include <random>
+#include <unordered_set>
+
+using namespace hashing;
+
+namespace {
+    std::vector<htype> RandomKeys(std::mt19937_64 &gen, size_t num) {
+        std::unordered_set<htype, alt_hasher<htype>> keys;
+        while(keys.size() < num)
+            keys.emplace((htype(gen()) << 64u) | gen());
+        return {keys.begin(), keys.end()};
+    }
+
+    void CheckMinimalPerfect(const MPHF &mphf, const std::vector<htype> &keys) {
+        ASSERT_EQ(mphf.size(), keys.size());
+        std::vector<bool> used(keys.size(), false);
+        for(const htype &key : keys) {
+            size_t ind = mphf.lookup(key);
+            ASSERT_LT(ind, keys.size());
+            ASSERT_FALSE(used[ind]);
+            used[ind] = true;
+        }
+    }
+}
+
+TEST(MPHFTest, DistinctSlots) {
+    std::mt19937_64 gen(1);
+    for(size_t num : {0, 1, 2, 63, 64, 65, 1000, 100000}) {
+        std::vector<htype> keys = RandomKeys(gen, num);
+        CheckMinimalPerfect(MPHF(keys, 4), keys);
+    }
+}
+
+TEST(MPHFTest, FallbackMap) {
+    std::mt19937_64 gen(2);
+    std::vector<htype> keys = RandomKeys(gen, 10000);
+//    With a single level most keys collide and are placed into the fallback map
+    MPHF mphf(keys, 4, 1);
+    ASSERT_GT(mphf.fallbackSize(), 0u);
+    CheckMinimalPerfect(mphf, keys);
+    MPHF no_levels(keys, 4, 0);
+    ASSERT_EQ(no_levels.fallbackSize(), keys.size());
+    CheckMinimalPerfect(no_levels, keys);
+}
+
+TEST(MPHFTest, AbsentKeys) {
+    std::mt19937_64 gen(3);
+    std::vector<htype> keys = RandomKeys(gen, 1000);
+    MPHF mphf(keys, 4, 1);
+    std::unordered_set<htype, alt_hasher<htype>> key_set(keys.begin(), keys.end());
+    for(const htype &key : RandomKeys(gen, 1000)) {
+        if(key_set.find(key) != key_set.end())
+            continue;
+        size_t ind = mphf.lookup(key);
+        ASSERT_TRUE(ind == size_t(-1) || ind < keys.size());
+    }
+}
+
+namespace {
+    struct Value {
+        htype key;
+        size_t val = 0;
+        explicit Value(htype key) : key(key) {}
+    };
+
+//    Counts constructed and not yet destroyed instances
+    struct LiveValue {
+        static size_t live;
+        htype key;
+        explicit LiveValue(htype key) : key(key) {live++;}
+        LiveValue(const LiveValue &other) : key(other.key) {live++;}
+        ~LiveValue() {live--;}
+    };
+    size_t LiveValue::live = 0;
+}
+
+TEST(PerfectHashMapTest, StaticAndDynamicParts) {
+    std::mt19937_64 gen(4);
+    std::vector<htype> all = RandomKeys(gen, 3000);
+    std::vector<htype> static_keys(all.begin(), all.begin() + 2000);
+    std::vector<htype> dynamic_keys(all.begin() + 2000, all.begin() + 2500);
+    std::vector<htype> absent(all.begin() + 2500, all.end());
+    PerfectHashMap<Value> map(static_keys, 4);
+    ASSERT_EQ(map.size(), static_keys.size());
+    ASSERT_EQ(map.staticSize(), static_keys.size());
+    for(const htype &key : static_keys) {
+        auto it = map.find(key);
+        ASSERT_TRUE(it != map.end());
+        ASSERT_TRUE(it->first == key && it->second.key == key);
+        it->second.val = 1;
+    }
+    for(const htype &key : dynamic_keys) {
+        ASSERT_TRUE(map.find(key) == map.end());
+        auto res = map.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(key));
+        ASSERT_TRUE(res.second);
+        res.first->second.val = 2;
+    }
+    ASSERT_EQ(map.staticSize(), static_keys.size());
+    ASSERT_EQ(map.size(), static_keys.size() + dynamic_keys.size());
+    for(const htype &key : static_keys) {
+        auto res = map.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(key));
+        ASSERT_FALSE(res.second);
+        ASSERT_EQ(res.first->second.val, 1u);
+    }
+    for(const htype &key : dynamic_keys)
+        ASSERT_EQ(map.find(key)->second.val, 2u);
+    for(const htype &key : absent)
+        ASSERT_TRUE(map.find(key) == map.end());
+
+//    Erase every other static and dynamic key and check that iteration visits exactly the remaining ones
+    std::unordered_set<htype, alt_hasher<htype>> remaining;
+    for(size_t i = 0; i < 2500; i++) {
+        if(i % 2 == 0)
+            map.erase(map.find(all[i]));
+        else
+            remaining.emplace(all[i]);
+    }
+    ASSERT_EQ(map.size(), remaining.size());
+    size_t visited = 0;
+    for(const auto &it : map) {
+        ASSERT_TRUE(remaining.find(it.first) != remaining.end());
+        visited++;
+    }
+    ASSERT_EQ(visited, remaining.size());
+    for(size_t i = 0; i < 2500; i += 2)
+        ASSERT_TRUE(map.find(all[i]) == map.end());
+}
+
+TEST(PerfectHashMapTest, SparseDBGAddVertex) {
+    std::mt19937_64 gen(5);
+    std::vector<htype> all = RandomKeys(gen, 200);
+    std::vector<htype> initial(all.begin(), all.begin() + 100);
+    dbg::SparseDBG dbg(initial, hashing::RollingHash(31, 239), 2);
+    for(size_t i = 100; i < 150; i++)
+        dbg.addVertex(all[i]);
+    ASSERT_EQ(dbg.size(), 150u);
+    for(size_t i = 0; i < 150; i++) {
+        ASSERT_TRUE(dbg.containsVertex(all[i]));
+        ASSERT_EQ(dbg.getVertex(all[i]).hash(), all[i]);
+    }
+    for(size_t i = 150; i < all.size(); i++)
+        ASSERT_FALSE(dbg.containsVertex(all[i]));
+}
+
+TEST(PerfectHashMapTest, MoveAssignment) {
+    std::mt19937_64 gen(6);
+    std::vector<htype> all = RandomKeys(gen, 1600);
+    std::vector<htype> a_keys(all.begin(), all.begin() + 1000);
+    std::vector<htype> b_keys(all.begin() + 1000, all.begin() + 1500);
+    {
+        PerfectHashMap<LiveValue> a(a_keys, 2);
+        PerfectHashMap<LiveValue> b(b_keys, 2);
+        for(size_t i = 1500; i < all.size(); i++)
+            b.emplace(std::piecewise_construct, std::forward_as_tuple(all[i]), std::forward_as_tuple(all[i]));
+        for(size_t i = 0; i < a_keys.size(); i += 3)
+            a.erase(a.find(a_keys[i]));
+        ASSERT_EQ(LiveValue::live, a.size() + b.size());
+//        Old static values of a are destroyed using its own alive flags before they are replaced by the ones of b
+        a = std::move(b);
+        ASSERT_EQ(LiveValue::live, all.size() - a_keys.size());
+        ASSERT_EQ(a.size(), all.size() - a_keys.size());
+        for(size_t i = 1000; i < all.size(); i++) {
+            auto it = a.find(all[i]);
+            ASSERT_TRUE(it != a.end() && it->second.key == all[i]);
+        }
+        for(const htype &key : a_keys)
+            ASSERT_TRUE(a.find(key) == a.end());
+        a = PerfectHashMap<LiveValue>();
+        ASSERT_EQ(LiveValue::live, 0u);
+        ASSERT_TRUE(a.empty());
+    }
+    ASSERT_EQ(LiveValue::live, 0u);
+    dbg::SparseDBG dbg(a_keys, hashing::RollingHash(31, 239), 2);
+    dbg = dbg::SparseDBG(b_keys, hashing::RollingHash(31, 239), 2);
+    ASSERT_EQ(dbg.size(), b_keys.size());
+    ASSERT_TRUE(dbg.containsVertex(b_keys[0]) && !dbg.containsVertex(a_keys[0]));
+}
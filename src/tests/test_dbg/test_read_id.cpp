@@ -0,0 +1,35 @@
+#include "gtest/gtest.h"
+#include "dbg/read_id.hpp"
+#include <omp.h>
+
+TEST(ReadIdTest, EqualNamesShareRecord) {
+    ReadId a(std::string("read_1"));
+    ReadId b("read_1");
+    ReadId c("read_2");
+    ASSERT_EQ(a.data(), b.data());
+    ASSERT_TRUE(a == b);
+    ASSERT_TRUE(a != c);
+    ASSERT_TRUE(a < c);
+    ASSERT_EQ(a.str(), "read_1");
+    ASSERT_TRUE(ReadId().empty());
+    ASSERT_TRUE(ReadId("") == ReadId());
+}
+
+TEST(ReadIdTest, ConcurrentInterning) {
+    size_t num = 20011;
+    std::vector<std::vector<ReadId>> ids(4, std::vector<ReadId>(num));
+//    Every thread interns the same names in a different order so that records are created concurrently. num is prime
+//    so every stride visits all names.
+#pragma omp parallel for num_threads(4) schedule(static, 1)
+    for(size_t t = 0; t < 4; t++) {
+        for(size_t i = 0; i < num; i++) {
+            size_t ind = (i * (2 * t + 1)) % num;
+            ids[t][ind] = ReadId("concurrent_read_" + std::to_string(ind));
+        }
+    }
+    for(size_t i = 0; i < num; i++) {
+        ASSERT_EQ(ids[0][i].str(), "concurrent_read_" + std::to_string(i));
+        for(size_t t = 1; t < 4; t++)
+            ASSERT_EQ(ids[t][i].data(), ids[0][i].data());
+    }
+}
@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+#include "error_correction/ff.hpp"
+#include <random>
+
+namespace {
+    struct RandomEdge {
+        size_t from;
+        size_t to;
+        size_t min_capacity;
+        size_t max_capacity;
+    };
+
+//    Bounds are chosen around a random circulation so the network is feasible unless some lower bounds are raised
+    std::vector<RandomEdge> RandomEdges(std::mt19937 &gen, size_t n, bool feasible) {
+        std::vector<RandomEdge> res;
+        size_t edge_num = n + gen() % (2 * n);
+        for(size_t i = 0; i < edge_num; i++)
+            res.push_back({gen() % n, gen() % n, 0, 0});
+        std::vector<size_t> flow(res.size(), 0);
+        for(size_t cycle = 0; cycle < n; cycle++) {
+//            Walk random edges until a vertex repeats and push one unit of flow along the cycle found
+            size_t start = gen() % n;
+            std::vector<size_t> path;
+            std::vector<size_t> visited(n, size_t(-1));
+            size_t cur = start;
+            visited[cur] = 0;
+            for(size_t step = 0; step < 3 * n; step++) {
+                std::vector<size_t> out;
+                for(size_t i = 0; i < res.size(); i++) {
+                    if(res[i].from == cur)
+                        out.push_back(i);
+                }
+                if(out.empty())
+                    break;
+                size_t e = out[gen() % out.size()];
+                path.push_back(e);
+                cur = res[e].to;
+                if(visited[cur] != size_t(-1)) {
+                    for(size_t i = visited[cur]; i < path.size(); i++)
+                        flow[path[i]]++;
+                    break;
+                }
+                visited[cur] = path.size();
+            }
+        }
+        for(size_t i = 0; i < res.size(); i++) {
+            res[i].min_capacity = flow[i] - gen() % (flow[i] + 1);
+            res[i].max_capacity = flow[i] + gen() % 3;
+            if(!feasible && gen() % 4 == 0) {
+                res[i].min_capacity += 1 + gen() % 2;
+                res[i].max_capacity = std::max(res[i].max_capacity, res[i].min_capacity);
+            }
+        }
+        return std::move(res);
+    }
+
+//    Independent feasibility check: Edmonds-Karp on the usual reduction of lower bounds to source and sink edges
+    bool NaiveFeasible(size_t n, const std::vector<RandomEdge> &edges) {
+        size_t source = n;
+        size_t sink = n + 1;
+        std::vector<std::vector<size_t>> cap(n + 2, std::vector<size_t>(n + 2, 0));
+        size_t need = 0;
+        for(const RandomEdge &e : edges) {
+            cap[e.from][e.to] += e.max_capacity - e.min_capacity;
+            cap[source][e.to] += e.min_capacity;
+            cap[e.from][sink] += e.min_capacity;
+            need += e.min_capacity;
+        }
+        size_t total = 0;
+        while(true) {
+            std::vector<size_t> prev(n + 2, size_t(-1));
+            std::queue<size_t> queue;
+            prev[source] = source;
+            queue.push(source);
+            while(!queue.empty() && prev[sink] == size_t(-1)) {
+                size_t v = queue.front();
+                queue.pop();
+                for(size_t u = 0; u < n + 2; u++) {
+                    if(cap[v][u] > 0 && prev[u] == size_t(-1)) {
+                        prev[u] = v;
+                        queue.push(u);
+                    }
+                }
+            }
+            if(prev[sink] == size_t(-1))
+                break;
+            size_t val = size_t(-1);
+            for(size_t v = sink; v != source; v = prev[v])
+                val = std::min(val, cap[prev[v]][v]);
+            for(size_t v = sink; v != source; v = prev[v]) {
+                cap[prev[v]][v] -= val;
+                cap[v][prev[v]] += val;
+            }
+            total += val;
+        }
+        return total == need;
+    }
+
+//    Definition of isInLoop before residual loops were cached: one BFS per query
+    void CheckLoops(Network &network, size_t edge_num) {
+        for(int id = 1; id <= int(edge_num); id++) {
+            for(int eid : {id, -id}) {
+                bool expected = network.getEdge(eid).capacity > 0 && !network.findLoop(eid).empty();
+                ASSERT_EQ(network.isInLoop(eid), expected) << "edge " << eid;
+            }
+        }
+    }
+
+    void CheckCirculation(Network &network, size_t n, const std::vector<size_t> &vertices,
+                          const std::vector<RandomEdge> &edges, const std::vector<int> &ids) {
+        std::vector<long long> balance(n, 0);
+        for(size_t i = 0; i < edges.size(); i++) {
+            size_t flow = network.getFlow(ids[i]);
+            ASSERT_GE(flow, edges[i].min_capacity);
+            ASSERT_LE(flow, edges[i].max_capacity);
+            balance[edges[i].from] -= flow;
+            balance[edges[i].to] += flow;
+        }
+        for(size_t v = 0; v < n; v++) {
+            ASSERT_EQ(balance[v], 0) << "vertex " << vertices[v];
+        }
+    }
+}
+
+TEST(NetworkTest, FillNetworkFeasibility) {
+    std::mt19937 gen(3);
+    size_t feasible_cnt = 0;
+    for(size_t iter = 0; iter < 300; iter++) {
+        size_t n = 2 + gen() % 10;
+        std::vector<RandomEdge> edges = RandomEdges(gen, n, iter % 2 == 0);
+        Network network;
+        std::vector<size_t> vertices;
+        for(size_t v = 0; v < n; v++)
+            vertices.push_back(network.addVertex());
+        std::vector<int> ids;
+        for(const RandomEdge &e : edges)
+            ids.push_back(network.addEdge(vertices[e.from], vertices[e.to], e.min_capacity, e.max_capacity));
+        bool filled = network.fillNetwork();
+        ASSERT_EQ(filled, NaiveFeasible(n, edges)) << "iteration " << iter;
+        if(!filled)
+            continue;
+        feasible_cnt++;
+        ASSERT_NO_FATAL_FAILURE(CheckCirculation(network, n, vertices, edges, ids));
+    }
+    ASSERT_GT(feasible_cnt, 150u);
+}
+
+TEST(NetworkTest, IsInLoopMatchesFindLoop) {
+    std::mt19937 gen(5);
+    for(size_t iter = 0; iter < 300; iter++) {
+        size_t n = 2 + gen() % 10;
+        std::vector<RandomEdge> edges = RandomEdges(gen, n, true);
+        Network network;
+        std::vector<size_t> vertices;
+        for(size_t v = 0; v < n; v++)
+            vertices.push_back(network.addVertex());
+        for(const RandomEdge &e : edges)
+            network.addEdge(vertices[e.from], vertices[e.to], e.min_capacity, e.max_capacity);
+        ASSERT_TRUE(network.fillNetwork());
+        size_t edge_num = network.findBounds().size();
+        ASSERT_NO_FATAL_FAILURE(CheckLoops(network, edge_num));
+//        Edges added after the first fill change the residual graph and must invalidate cached loops
+        network.addSource(vertices[gen() % n], 1);
+        for(size_t i = 0; i < 2; i++)
+            network.addSink(vertices[gen() % n], 1 + gen() % 2);
+        network.fillNetwork();
+        edge_num = network.findBounds().size();
+        ASSERT_NO_FATAL_FAILURE(CheckLoops(network, edge_num));
+    }
+}
@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+#include "sequences/sequence.hpp"
+#include <random>
+
+namespace {
+    std::string RandomNucls(std::mt19937 &gen, size_t len) {
+        std::string res;
+        for(size_t i = 0; i < len; i++)
+            res += "ACGT"[gen() % 4];
+        return res;
+    }
+
+    size_t NaiveCommonPrefix(const Sequence &a, const Sequence &b) {
+        size_t res = 0;
+        while(res < a.size() && res < b.size() && a[res] == b[res])
+            res++;
+        return res;
+    }
+
+    size_t NaiveCommonSuffix(const Sequence &a, const Sequence &b) {
+        size_t res = 0;
+        while(res < a.size() && res < b.size() && a[a.size() - 1 - res] == b[b.size() - 1 - res])
+            res++;
+        return res;
+    }
+
+    bool NaiveEqual(const Sequence &a, const Sequence &b) {
+        return a.size() == b.size() && NaiveCommonPrefix(a, b) == a.size();
+    }
+
+//    Same order as Sequence::operator<: the first differing nucleotide decides, and a sequence is smaller than its
+//    own proper prefix
+    bool NaiveLess(const Sequence &a, const Sequence &b) {
+        for(size_t i = 0; i < a.size(); i++) {
+            if(i == b.size())
+                return true;
+            if(a[i] != b[i])
+                return a[i] < b[i];
+        }
+        return false;
+    }
+
+    void CheckAgainstNaive(const Sequence &a, const Sequence &b) {
+        ASSERT_EQ(a.commonPrefix(b), NaiveCommonPrefix(a, b)) << a << " " << b;
+        ASSERT_EQ(a.commonSuffix(b), NaiveCommonSuffix(a, b)) << a << " " << b;
+        ASSERT_EQ(a == b, NaiveEqual(a, b)) << a << " " << b;
+        ASSERT_EQ(a < b, NaiveLess(a, b)) << a << " " << b;
+        ASSERT_EQ(b < a, NaiveLess(b, a)) << a << " " << b;
+    }
+
+//    Returns a view of seq with random offset and length that may be reverse complement and may be a subsequence of a
+//    reverse complement view
+    Sequence RandomView(std::mt19937 &gen, const Sequence &seq) {
+        Sequence res = seq;
+        for(size_t step = 0; step < 2; step++) {
+            size_t from = gen() % (res.size() + 1);
+            size_t to = from + gen() % (res.size() - from + 1);
+            res = res.Subseq(from, to);
+            if(gen() % 2 == 0)
+                res = !res;
+        }
+        return res;
+    }
+}
+
+TEST(SequenceCompareTest, WordBoundaryLengths) {
+    std::mt19937 gen(1);
+    for(size_t len : {1, 2, 31, 32, 33, 63, 64, 65, 95, 96, 97, 128}) {
+        for(size_t iter = 0; iter < 200; iter++) {
+            std::string s = RandomNucls(gen, len + 70);
+            Sequence seq(s);
+            size_t from = gen() % 70;
+            Sequence a = seq.Subseq(from, from + len);
+            std::string t = s.substr(from, len);
+            if(gen() % 2 == 0)
+                t[gen() % len] = "ACGT"[gen() % 4];
+            Sequence b(t);
+            CheckAgainstNaive(a, b);
+            CheckAgainstNaive(!a, !b);
+            CheckAgainstNaive(!a, (!Sequence(t + "A")).Subseq(1));
+            CheckAgainstNaive(a, (!!Sequence("C" + t)).Subseq(1));
+        }
+    }
+}
+
+TEST(SequenceCompareTest, RandomViews) {
+    std::mt19937 gen(2);
+    for(size_t iter = 0; iter < 20000; iter++) {
+        std::string s = RandomNucls(gen, gen() % 200 + 1);
+        std::string t = s;
+        if(gen() % 2 == 0)
+            t[gen() % t.size()] = "ACGT"[gen() % 4];
+        Sequence a(s);
+        Sequence b(t);
+        CheckAgainstNaive(RandomView(gen, a), RandomView(gen, b));
+//        Views at equal offsets of equal sequences are long matches across word boundaries
+        size_t from = gen() % (s.size() + 1);
+        Sequence va = a.Subseq(from);
+        Sequence vb = b.Subseq(from);
+        CheckAgainstNaive(va, vb);
+        CheckAgainstNaive(!va, !vb);
+        CheckAgainstNaive((!a).Subseq(from), (!b).Subseq(from));
+    }
+}
+
+TEST(SequenceCompareTest, Contains) {
+    std::mt19937 gen(3);
+    for(size_t iter = 0; iter < 5000; iter++) {
+        Sequence seq(RandomNucls(gen, gen() % 150 + 1));
+        if(gen() % 2 == 0)
+            seq = !seq;
+        size_t from = gen() % (seq.size() + 1);
+        size_t to = from + gen() % (seq.size() - from + 1);
+        Sequence sub = seq.Subseq(from, to);
+        ASSERT_TRUE(seq.contains(sub, from));
+        ASSERT_TRUE(seq.contains(Sequence(sub.str()), from));
+        if(!sub.empty()) {
+            std::string other = sub.str();
+            size_t pos = gen() % other.size();
+            other[pos] = nucl((dignucl(other[pos]) + 1) % 4);
+            ASSERT_FALSE(seq.contains(Sequence(other), from));
+        }
+    }
+}
+
+TEST(SequenceConcatTest, MatchesStrings) {
+    std::mt19937 gen(4);
+    for(size_t iter = 0; iter < 5000; iter++) {
+        Sequence a = RandomView(gen, Sequence(RandomNucls(gen, gen() % 150 + 1)));
+        Sequence b = RandomView(gen, Sequence(RandomNucls(gen, gen() % 150 + 1)));
+        ASSERT_EQ((a + b).str(), a.str() + b.str());
+    }
+}
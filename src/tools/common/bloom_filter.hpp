@@ -3,6 +3,9 @@
 //
 
 #pragma once
+#include "hash_utils.hpp"
+#include "omp_utils.hpp"
+#include "verify.hpp"
 #include <algorithm>
 //#include <cmath>
 //#include <cstddef>
@@ -11,6 +14,13 @@
 #include <limits>
 #include <string>
 #include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 
 static const std::size_t bits_per_char = 0x08;    // 8 bits in 1 char(unsigned)
@@ -669,4 +679,128 @@ public:
         }
         inserted_element_count_ += b.size();
     }
-};
\ No newline at end of file
+};
+/*
+ * Split block Bloom filter. Every element sets one bit in each of the eight 32-bit words of a single 256-bit block.
+ * Table is aligned to 64 bytes, so a block never crosses a cache line and insertion and lookup touch one cache line.
+ * Elements are given as precomputed hashes and no additional hashing of key bytes is performed. Lookups use AVX2 when
+ * the project is configured with -DLJA_AVX2=ON.
+ */
+class BlockedBloomFilter {
+private:
+    static constexpr size_t block_words = 8;
+    static constexpr size_t cache_line = 64;
+    struct FreeTable {
+        void operator()(uint32_t *table) const {std::free(table);}
+    };
+    std::unique_ptr<uint32_t[], FreeTable> table_;
+    size_t block_num_;
+
+    static const uint32_t *salt() {
+        alignas(32) static const uint32_t res[block_words] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                                              0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+        return res;
+    }
+
+    static uint64_t reduce(const hashing::htype &hash) {
+        return hashing::mix64(uint64_t(hash) ^ hashing::mix64(uint64_t(hash >> 64u)));
+    }
+
+    size_t blockIndex(uint64_t hash) const {
+        return size_t(((hash >> 32u) * block_num_) >> 32u);
+    }
+
+    const uint32_t *block(uint64_t hash) const {
+        return table_.get() + blockIndex(hash) * block_words;
+    }
+
+    static bool blockContains(const uint32_t *block, uint32_t key) {
+#ifdef __AVX2__
+        const __m256i mask = makeMask(key);
+        const __m256i data = _mm256_load_si256(reinterpret_cast<const __m256i *>(block));
+        return _mm256_testc_si256(data, mask) != 0;
+#else
+        for(size_t i = 0; i < block_words; i++) {
+            if((block[i] & (uint32_t(1) << ((key * salt()[i]) >> 27u))) == 0)
+                return false;
+        }
+        return true;
+#endif
+    }
+
+#ifdef __AVX2__
+    static __m256i makeMask(uint32_t key) {
+        const __m256i salts = _mm256_load_si256(reinterpret_cast<const __m256i *>(salt()));
+        __m256i shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(int(key)), salts), 27);
+        return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+    }
+#endif
+
+public:
+//    Filter size is chosen from expected number of elements and desired false positive rate. Blocked filters need about
+//    50% more bits than classic ones to reach the same rate.
+    BlockedBloomFilter(size_t projected_element_count, double false_positive_probability) {
+        double bits_per_element = -std::log2(false_positive_probability) * 1.44 * 1.5;
+        size_t bits = std::max<size_t>(size_t(double(projected_element_count) * bits_per_element), 256);
+        block_num_ = (bits + 255) / 256;
+        size_t bytes = (block_num_ * block_words * sizeof(uint32_t) + cache_line - 1) / cache_line * cache_line;
+        void *table = nullptr;
+        int status = posix_memalign(&table, cache_line, bytes);
+        VERIFY(status == 0);
+        table_.reset(static_cast<uint32_t *>(table));
+        std::fill(table_.get(), table_.get() + block_num_ * block_words, uint32_t(0));
+    }
+
+    size_t size() const {return block_num_ * block_words * 32;}
+
+//    Thread safe. Only words that do not yet contain required bit are updated atomically.
+    void insertHash(uint64_t hash) {
+        uint32_t *b = table_.get() + blockIndex(hash) * block_words;
+        uint32_t key = uint32_t(hash);
+        for(size_t i = 0; i < block_words; i++) {
+            uint32_t mask = uint32_t(1) << ((key * salt()[i]) >> 27u);
+            if((b[i] & mask) == 0) {
+#pragma omp atomic update
+                b[i] |= mask;
+            }
+        }
+    }
+
+    bool containsHash(uint64_t hash) const {
+        return blockContains(block(hash), uint32_t(hash));
+    }
+
+    void insert(const hashing::htype &hash) {
+        insertHash(reduce(hash));
+    }
+
+    bool contains(const hashing::htype &hash) const {
+        return containsHash(reduce(hash));
+    }
+
+//    Checks all 4 right and all 4 left extensions of a k-mer. Bit c of the result is set if right extension by c is
+//    present and bit 4 + c is set if left extension by c is present. All eight blocks are prefetched before the checks.
+    template<class KmerWithHash>
+    unsigned char containsExtensions(const KmerWithHash &kmer) const {
+        uint64_t hashes[8];
+        for(unsigned char c = 0; c < 4u; c++) {
+            hashes[c] = reduce(kmer.extendRight(c));
+            hashes[c + 4] = reduce(kmer.extendLeft(c));
+        }
+        for(uint64_t hash : hashes)
+            __builtin_prefetch(block(hash));
+        unsigned char res = 0;
+        for(size_t i = 0; i < 8; i++) {
+            if(containsHash(hashes[i]))
+                res |= (unsigned char)(1u << i);
+        }
+        return res;
+    }
+
+    std::pair<size_t, size_t> count_bits() const {
+        size_t res = 0;
+        for(size_t i = 0; i < block_num_ * block_words; i++)
+            res += __builtin_popcount(table_[i]);
+        return {res, size()};
+    }
+};
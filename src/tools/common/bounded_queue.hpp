@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+//Blocking queue of fixed capacity connecting a producer thread with a consumer thread. push blocks while the queue is
+//full and pop blocks while it is empty. After close push fails and pop returns remaining items and then fails.
+template<class T>
+class BoundedQueue {
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+//    Returns false if the queue was closed and value was not added
+    bool push(T &&value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this]() {return closed || items.size() < capacity;});
+        if(closed)
+            return false;
+        items.emplace_back(std::move(value));
+        lock.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+//    Returns false if the queue was closed and all items were already taken
+    bool pop(T &value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this]() {return closed || !items.empty();});
+        if(items.empty())
+            return false;
+        value = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+};
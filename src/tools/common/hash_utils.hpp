@@ -1,10 +1,24 @@
 #pragma once
 #include <iostream>
 #include <vector>
+#include <cstdint>
 
 namespace hashing {
     typedef unsigned __int128 htype;
 
+    inline uint64_t mix64(uint64_t x) {
+        x ^= x >> 33u;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33u;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33u;
+        return x;
+    }
+
+    inline uint64_t seededHash(const htype &key, uint64_t seed) {
+        return mix64(uint64_t(key) ^ (seed * 0x9e3779b97f4a7c15ull)) ^ mix64(uint64_t(key >> 64u) + seed);
+    }
+
     template<class Key>
     struct alt_hasher {
         size_t operator()(const Key &k) const;
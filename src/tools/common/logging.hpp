@@ -96,16 +96,19 @@ namespace logging {
     class Logger : public std::streambuf , public std::ostream {
     private:
         struct LogStream {
-            std::ofstream * os;
+            std::ostream * os;
             LogLevel level;
+            bool owned;
             LogStream(const std::experimental::filesystem::path &fn, LogLevel level) :
-                    os(new std::ofstream()), level(level) {
-                os->open(fn);
+                    os(new std::ofstream(fn)), level(level), owned(true) {
+            }
+
+            LogStream(std::ostream &os, LogLevel level) : os(&os), level(level), owned(false) {
             }
 
             ~LogStream() {
-                os->close();
-                delete os;
+                if(owned)
+                    delete os;
                 os = nullptr;
             }
         };
@@ -120,6 +123,13 @@ namespace logging {
                     std::ostream(this), curlevel(LogLevel::trace), add_cout(_add_cout) {
         }
 
+    //    Logger that writes messages to os instead of console and log files and counts time from the start of parent.
+    //    Parallel tasks use it to collect their messages and print them to parent in one piece when they finish.
+        Logger(const Logger &parent, std::ostream &os, LogLevel level = LogLevel::trace) :
+                    std::ostream(this), time(parent.time), curlevel(LogLevel::trace), add_cout(false) {
+            oss.emplace_back(os, level);
+        }
+
         Logger(const Logger &) = delete;
 
         void addLogFile(const std::experimental::filesystem::path &fn, LogLevel level = LogLevel::trace) {
@@ -136,7 +146,7 @@ namespace logging {
     //    }
 
         int overflow(int c) override {
-            if(curlevel <= LogLevel::info)
+            if(add_cout && curlevel <= LogLevel::info)
                 std::cout << char(c);
             for(LogStream &os : oss) {
                 if(curlevel <= os.level)
@@ -149,7 +159,7 @@ namespace logging {
         }
 
         void forceFlush() {
-            if(curlevel <= LogLevel::info)
+            if(add_cout && curlevel <= LogLevel::info)
                 std::cout.flush();
             for(LogStream &os : oss) {
                 if(curlevel <= os.level)
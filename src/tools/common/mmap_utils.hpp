@@ -0,0 +1,103 @@
+#pragma once
+
+#include "verify.hpp"
+#include <experimental/filesystem>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//Read-only memory mapping of a whole file. Mapping is released in destructor.
+class MappedFile {
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+
+    void release() {
+        if(data_ != nullptr && size_ > 0)
+            munmap(const_cast<char *>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+public:
+    explicit MappedFile(const std::experimental::filesystem::path &path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return;
+        struct stat statbuf{};
+        if(fstat(fd, &statbuf) == 0 && statbuf.st_size > 0) {
+            void *ptr = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(ptr != MAP_FAILED) {
+                data_ = static_cast<const char *>(ptr);
+                size_ = statbuf.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    MappedFile(MappedFile &&other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() {release();}
+
+    bool valid() const {return data_ != nullptr;}
+    const char *data() const {return data_;}
+    size_t size() const {return size_;}
+
+//    Tells the kernel that the file will be read front to back
+    void adviseSequential() const {
+        if(valid())
+            madvise(const_cast<char *>(data_), size_, MADV_SEQUENTIAL);
+    }
+};
+
+//Sequential reader of trivially copyable values from a memory buffer. All reads are bounds checked.
+class BinaryCursor {
+private:
+    const char *data_;
+    size_t size_;
+    size_t pos_ = 0;
+public:
+    BinaryCursor(const char *data, size_t size) : data_(data), size_(size) {}
+
+    size_t pos() const {return pos_;}
+    size_t left() const {return size_ - pos_;}
+    const char *current() const {return data_ + pos_;}
+
+    template<class T>
+    T read() {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read");
+        VERIFY(left() >= sizeof(T));
+        T res;
+        std::memcpy(&res, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return res;
+    }
+
+    std::string readString(size_t len) {
+        VERIFY(left() >= len);
+        std::string res(data_ + pos_, len);
+        pos_ += len;
+        return res;
+    }
+
+    const char *skip(size_t len) {
+        VERIFY(left() >= len);
+        const char *res = data_ + pos_;
+        pos_ += len;
+        return res;
+    }
+};
+
+template<class T>
+inline void writeBinary(std::ostream &os, const T &val) {
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written");
+    os.write(reinterpret_cast<const char *>(&val), sizeof(T));
+}
@@ -3,7 +3,19 @@
 //
 #pragma once
 #include "logging.hpp"
+#include "stage_profiler.hpp"
+#include "verify.hpp"
+#include "spin_lock.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <cstdint>
 #include <parallel/algorithm>
 #include <omp.h>
 #include <utility>
@@ -145,6 +157,218 @@ std::ostream& operator<<(std::ostream& out, const ParallelRecordCollector<T>& tr
     return out << "]";
 }
 
+//Array of values addressed by item number that can be filled from many threads without knowing the number of items in
+//advance. Values are stored in segments that are allocated on first use and never move, so writing to a slot never
+//waits for other threads.
+template<class T>
+class ParallelSlotArray {
+private:
+    static constexpr size_t segment_bits = 14;
+    static constexpr size_t segment_size = size_t(1) << segment_bits;
+    static constexpr size_t max_segments = size_t(1) << 18u;
+    std::unique_ptr<std::atomic<T *>[]> segments;
+    std::atomic<size_t> slot_num{0};
+
+public:
+    ParallelSlotArray() : segments(new std::atomic<T *>[max_segments]) {
+        for(size_t i = 0; i < max_segments; i++)
+            segments[i] = nullptr;
+    }
+
+    ParallelSlotArray(const ParallelSlotArray &) = delete;
+    ParallelSlotArray &operator=(const ParallelSlotArray &) = delete;
+
+    ~ParallelSlotArray() {
+        for(size_t i = 0; i < max_segments; i++)
+            delete[] segments[i].load();
+    }
+
+    T &operator[](size_t pos) {
+        size_t seg = pos >> segment_bits;
+        VERIFY(seg < max_segments);
+        T *res = segments[seg].load(std::memory_order_acquire);
+        if(res == nullptr) {
+            T *created = new T[segment_size];
+            if(segments[seg].compare_exchange_strong(res, created, std::memory_order_acq_rel))
+                res = created;
+            else
+                delete[] created;
+        }
+        size_t cur = slot_num.load(std::memory_order_relaxed);
+        while(cur <= pos && !slot_num.compare_exchange_weak(cur, pos + 1, std::memory_order_relaxed)) {
+        }
+        return res[pos & (segment_size - 1)];
+    }
+
+//    Number of slots up to the last one that was accessed
+    size_t size() const {
+        return slot_num.load();
+    }
+
+//    Moves values out of the slots to a vector. Each segment is freed as soon as it is moved.
+    std::vector<T> collect() {
+        std::vector<T> res;
+        res.reserve(size());
+        for(size_t seg = 0; seg * segment_size < size(); seg++) {
+            T *values = segments[seg].exchange(nullptr);
+            for(size_t i = 0; i < segment_size && seg * segment_size + i < size(); i++)
+                res.emplace_back(values == nullptr ? T() : std::move(values[i]));
+            delete[] values;
+        }
+        slot_num = 0;
+        return std::move(res);
+    }
+};
+
+//Counts occurrences of distinct values added from many threads. Values are partitioned into shards by hash and each thread
+//buffers values per shard. Full buffers are merged into shard tables so threads rarely wait for the same shard and
+//duplicates are removed while values are added instead of being stored until the end. Shard tables use open addressing
+//with linear probing over flat arrays so that a distinct value costs one key and one counter and no allocations.
+template<class T, class Hasher>
+class ParallelUniqueCounter {
+private:
+//    Slots with zero count are empty. The table has 2^bits slots and is doubled when it becomes 3/4 full.
+    struct Shard {
+        std::vector<T> values;
+        std::vector<uint32_t> counts;
+        size_t size = 0;
+        size_t bits = 0;
+        SpinLock lock;
+    };
+    size_t shard_bits;
+    size_t buffer_size;
+    std::vector<Shard> shards;
+    std::vector<std::vector<std::vector<T>>> buffers;
+
+    static uint64_t mix(const T &value) {
+        return uint64_t(Hasher()(value)) * 0x9e3779b97f4a7c15ull;
+    }
+
+    size_t shardIndex(const T &value) const {
+        return size_t(mix(value) >> (64u - shard_bits));
+    }
+
+//    Slot of a value in its shard is taken from the bits of the mixed hash that follow the shard bits
+    size_t slot(const T &value, size_t bits) const {
+        return size_t((mix(value) << shard_bits) >> (64u - bits));
+    }
+
+    void insert(Shard &shard, const T &value, uint32_t count) {
+        size_t mask = shard.counts.size() - 1;
+        size_t pos = slot(value, shard.bits);
+        while(shard.counts[pos] != 0 && !(shard.values[pos] == value))
+            pos = (pos + 1) & mask;
+        if(shard.counts[pos] == 0) {
+            shard.values[pos] = value;
+            shard.size++;
+        }
+        shard.counts[pos] += count;
+    }
+
+    void grow(Shard &shard) {
+        size_t bits = shard.counts.empty() ? 4 : shard.bits + 1;
+        VERIFY(bits + shard_bits <= 64);
+        std::vector<T> values(size_t(1) << bits);
+        std::vector<uint32_t> counts(values.size(), 0);
+        std::swap(values, shard.values);
+        std::swap(counts, shard.counts);
+        shard.bits = bits;
+        shard.size = 0;
+        for(size_t i = 0; i < counts.size(); i++) {
+            if(counts[i] != 0)
+                insert(shard, values[i], counts[i]);
+        }
+    }
+
+    void flush(size_t shard_ind, std::vector<T> &buffer) {
+        Shard &shard = shards[shard_ind];
+        shard.lock.lock();
+        for(const T &value : buffer) {
+            if((shard.size + 1) * 4 > shard.counts.size() * 3)
+                grow(shard);
+            insert(shard, value, 1);
+        }
+        shard.lock.unlock();
+        buffer.clear();
+    }
+
+public:
+    ParallelUniqueCounter(size_t thread_num, size_t shard_bits = 8, size_t buffer_size = 1024) :
+                    shard_bits(shard_bits), buffer_size(buffer_size), shards(size_t(1) << shard_bits),
+                    buffers(thread_num, std::vector<std::vector<T>>(size_t(1) << shard_bits)) {
+        VERIFY(shard_bits > 0 && shard_bits < 32);
+    }
+
+    ParallelUniqueCounter(const ParallelUniqueCounter &) = delete;
+
+    void add(const T &value) {
+        size_t shard_ind = shardIndex(value);
+        std::vector<T> &buffer = buffers[omp_get_thread_num()][shard_ind];
+        buffer.emplace_back(value);
+        if(buffer.size() >= buffer_size)
+            flush(shard_ind, buffer);
+    }
+
+    template<class I>
+    void addAll(I begin, I end) {
+        for(; begin != end; ++begin)
+            add(*begin);
+    }
+
+//    Must be called after all values were added and before any queries. Can not be called concurrently with add.
+    void flushAll() {
+        for(std::vector<std::vector<T>> &thread_buffers : buffers) {
+            for(size_t i = 0; i < thread_buffers.size(); i++) {
+                if(!thread_buffers[i].empty())
+                    flush(i, thread_buffers[i]);
+            }
+        }
+    }
+
+    size_t size() const {
+        size_t res = 0;
+        for(const Shard &shard : shards)
+            res += shard.size;
+        return res;
+    }
+
+//    Number of distinct values in each shard
+    std::vector<size_t> shardSizes() const {
+        std::vector<size_t> res;
+        for(const Shard &shard : shards)
+            res.push_back(shard.size);
+        return std::move(res);
+    }
+
+//    res[i] is the number of distinct values that were added exactly i times. The last entry counts all larger values.
+    std::vector<size_t> histogram(size_t max_count = 100) const {
+        std::vector<size_t> res(max_count + 1);
+        for(const Shard &shard : shards)
+            for(uint32_t count : shard.counts)
+                if(count != 0)
+                    res[std::min<size_t>(count, max_count)] += 1;
+        return std::move(res);
+    }
+
+//    Returns sorted list of distinct values that were added at least min_count times and releases memory used by the
+//    counter.
+    std::vector<T> collectSorted(size_t min_count = 1) {
+        min_count = std::max<size_t>(min_count, 1);
+        std::vector<T> res;
+        res.reserve(size());
+        for(Shard &shard : shards) {
+            for(size_t i = 0; i < shard.counts.size(); i++)
+                if(shard.counts[i] >= min_count)
+                    res.emplace_back(shard.values[i]);
+            std::vector<T>().swap(shard.values);
+            std::vector<uint32_t>().swap(shard.counts);
+            shard.size = 0;
+        }
+        __gnu_parallel::sort(res.begin(), res.end());
+        return std::move(res);
+    }
+};
+
 
 template<class V>
 class ParallelProcessor {
@@ -245,6 +469,7 @@ public:
             total_len += clen;
         }
         doInTheEnd();
+        logging::StageTimer::Count(total, total_len);
         logger.trace() << "Finished parallel processing. Processed " << total <<
                " items with total length " << total_len << std::endl;
     }
@@ -298,12 +523,189 @@ public:
 
 };
 
+//Time threads of WorkStealingExecutor spent waiting. The reading thread waits when too many chunks are in flight and
+//processes chunks itself meanwhile. Workers wait when all read chunks are taken.
+struct ExecutorStalls {
+    double producer_sec = 0;
+    double consumer_sec = 0;
+};
+
+//Streaming executor of a task over items of an iterator. Thread 0 reads items and packs them into chunks of bounded
+//weight while the other threads process chunks that were read before, so reading overlaps with processing. Every
+//thread has its own deque of chunks. The reading thread deals chunks to the deques in turn and threads that run out of
+//work steal chunks from other deques. At most max_chunks chunks are in flight so memory does not depend on the size of
+//the input. Tasks run inside an OpenMP parallel region and omp_get_thread_num can be used to access per-thread storage.
+//Items get consecutive numbers in the order they were read.
+template<class S>
+class WorkStealingExecutor {
+private:
+    struct Chunk {
+        size_t first = 0;
+        std::vector<S> items;
+    };
+
+    struct Worker {
+        SpinLock lock;
+        std::deque<Chunk> chunks;
+        double stall = 0;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    const std::function<void(size_t, S &)> &task;
+    size_t threads;
+    size_t max_chunks;
+    std::vector<Worker> workers;
+    std::atomic<size_t> in_flight{0};
+    std::atomic<size_t> queued{0};
+    std::atomic<bool> done{false};
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+
+    static double seconds(Clock::time_point from) {
+        return std::chrono::duration<double>(Clock::now() - from).count();
+    }
+
+//    Idle threads yield for a while and then sleep until a new chunk is queued. Notifications are sent without holding
+//    the mutex so a wakeup can be missed and sleep is limited to keep the delay short in this case.
+    void wait(size_t attempt) {
+        if(attempt < 16) {
+            std::this_thread::yield();
+            return;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        wake.wait_for(lock, std::chrono::milliseconds(1), [this]() {return queued > 0 || (done && in_flight == 0);});
+    }
+
+//    Takes a chunk from the own deque or steals one from the back of another deque and processes it
+    bool runOne(size_t me) {
+        Chunk chunk;
+        bool found = false;
+        for(size_t k = 0; k < threads && !found; k++) {
+            Worker &worker = workers[(me + k) % threads];
+            worker.lock.lock();
+            if(!worker.chunks.empty()) {
+                if(k == 0) {
+                    chunk = std::move(worker.chunks.front());
+                    worker.chunks.pop_front();
+                } else {
+                    chunk = std::move(worker.chunks.back());
+                    worker.chunks.pop_back();
+                }
+                found = true;
+                queued -= 1;
+            }
+            worker.lock.unlock();
+        }
+        if(!found)
+            return false;
+        for(size_t i = 0; i < chunk.items.size(); i++)
+            task(chunk.first + i, chunk.items[i]);
+        if(--in_flight == 0 && done)
+            wake.notify_all();
+        return true;
+    }
+
+    void work(size_t me) {
+        size_t attempt = 0;
+        Clock::time_point stall_start = Clock::now();
+        while(true) {
+            if(runOne(me)) {
+                if(attempt > 0)
+                    workers[me].stall += seconds(stall_start);
+                attempt = 0;
+                continue;
+            }
+            if(done && in_flight == 0)
+                break;
+            if(attempt == 0)
+                stall_start = Clock::now();
+            wait(attempt);
+            attempt++;
+        }
+        if(attempt > 0)
+            workers[me].stall += seconds(stall_start);
+    }
+
+public:
+    WorkStealingExecutor(const std::function<void(size_t, S &)> &task, size_t threads, size_t max_chunks) :
+                    task(task), threads(std::max<size_t>(threads, 1)), max_chunks(max_chunks),
+                    workers(std::max<size_t>(threads, 1)) {
+    }
+
+//    Processes all items. read(begin) returns the value stored for the current item and weight(value) is added to the
+//    weight of the current chunk. Chunk is closed when its weight reaches chunk_weight. Returns the number of items and
+//    their total weight.
+    template<class I, class Read, class Weight>
+    std::pair<size_t, size_t> run(I &begin, I end, size_t chunk_weight, const Read &read, const Weight &weight,
+                                  ExecutorStalls &stalls) {
+        size_t total = 0;
+        size_t total_weight = 0;
+        double producer_stall = 0;
+        omp_set_num_threads(threads);
+#pragma omp parallel default(none) shared(begin, end, chunk_weight, read, weight, total, total_weight, producer_stall)
+        {
+            size_t me = omp_get_thread_num() % threads;
+            if(omp_get_thread_num() == 0) {
+                size_t next = 0;
+                while(begin != end) {
+                    Chunk chunk;
+                    chunk.first = total;
+                    size_t cur_weight = 0;
+                    while(begin != end && cur_weight < chunk_weight) {
+                        chunk.items.emplace_back(read(begin));
+                        cur_weight += weight(chunk.items.back());
+                        ++begin;
+                    }
+                    total += chunk.items.size();
+                    total_weight += cur_weight;
+                    if(in_flight >= max_chunks) {
+                        Clock::time_point stall_start = Clock::now();
+                        size_t attempt = 0;
+                        while(in_flight >= max_chunks) {
+                            if(!runOne(me)) {
+                                wait(attempt);
+                                attempt++;
+                            }
+                        }
+                        producer_stall += seconds(stall_start);
+                    }
+                    Worker &worker = workers[next % threads];
+                    in_flight += 1;
+                    worker.lock.lock();
+                    worker.chunks.emplace_back(std::move(chunk));
+                    queued += 1;
+                    worker.lock.unlock();
+                    wake.notify_one();
+                    next++;
+                }
+                done = true;
+                wake.notify_all();
+            }
+            work(me);
+        }
+        stalls.producer_sec = producer_stall;
+        stalls.consumer_sec = 0;
+        for(Worker &worker : workers)
+            stalls.consumer_sec += worker.stall;
+        return {total, total_weight};
+    }
+};
+
 //This method expects that iterators return references to objects instead of temporary objects.
 template<class I>
 void processObjects(I begin, I end, logging::Logger &logger, size_t threads, std::function<void(size_t, typename I::value_type &)> task,
                     size_t bucket_size = 1024) {
     typedef typename I::value_type V;
-    ParallelProcessor<V>(task, logger, threads).processObjects(begin, end, bucket_size);
+    logger.trace() << "Starting parallel calculation" << std::endl;
+    std::function<void(size_t, V *&)> object_task = [&task](size_t num, V *&object) {
+        task(num, *object);
+    };
+    ExecutorStalls stalls;
+    std::pair<size_t, size_t> res = WorkStealingExecutor<V *>(object_task, threads, threads * 4).run(
+            begin, end, bucket_size, [](I &it) {return &*it;}, [](V *) {return size_t(1);}, stalls);
+    logger.trace() << "Finished parallel processing. Processed " << res.first << " items. Reading waited for "
+                   << stalls.producer_sec << "s, workers waited for " << stalls.consumer_sec << "s" << std::endl;
 }
 
 //This method expects iterator to be a generator, i.e. it returns temporary objects. Thus we have to store them in a buffer and
@@ -324,7 +726,14 @@ template<class I>
 void processRecords(I begin, I end, logging::Logger &logger, size_t threads, std::function<void(size_t, typename I::value_type &)> task,
                     size_t bucket_length = 1024 * 1024) {
     typedef typename I::value_type V;
-    ParallelProcessor<V>(task, logger, threads).processRecords(begin, end, bucket_length);
+    logger.trace() << "Starting parallel calculation using " << threads << " threads" << std::endl;
+    ExecutorStalls stalls;
+    std::pair<size_t, size_t> res = WorkStealingExecutor<V>(task, threads, threads * 4).run(
+            begin, end, bucket_length, [](I &it) {return *it;}, [](const V &item) {return size_t(item.size());}, stalls);
+    logging::StageTimer::Count(res.first, res.second);
+    logger.trace() << "Finished parallel processing. Processed " << res.first << " items with total length "
+                   << res.second << ". Reading waited for " << stalls.producer_sec << "s, workers waited for "
+                   << stalls.consumer_sec << "s" << std::endl;
 }
 
 /**
@@ -0,0 +1,345 @@
+//
+// Minimal perfect hashing of 128-bit k-mer hashes.
+//
+
+#pragma once
+#include "hash_utils.hpp"
+#include "verify.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hashing {
+//    Bit array with atomic set operation and constant time rank queries.
+    class RankedBitArray {
+    private:
+        std::vector<uint64_t> words;
+        std::vector<uint64_t> ranks;
+    public:
+        explicit RankedBitArray(size_t size = 0) : words((size + 63) / 64) {
+        }
+
+        size_t size() const {return words.size() * 64;}
+
+        bool get(size_t pos) const {return (words[pos >> 6u] >> (pos & 63u)) & 1u;}
+
+//        Returns previous value of the bit. Safe to call from several threads.
+        bool atomicSet(size_t pos) {
+            uint64_t mask = uint64_t(1) << (pos & 63u);
+            uint64_t old;
+            uint64_t &word = words[pos >> 6u];
+#pragma omp atomic capture
+            {old = word; word |= mask;}
+            return (old & mask) != 0;
+        }
+
+//        Clears all bits of this array that are set in other
+        void subtract(const RankedBitArray &other) {
+            for(size_t i = 0; i < words.size(); i++)
+                words[i] &= ~other.words[i];
+        }
+
+        void append(const RankedBitArray &other) {
+            words.insert(words.end(), other.words.begin(), other.words.end());
+        }
+
+//        Must be called after all modifications and before rank queries. One rank value is stored per 8 words.
+        void buildRank() {
+            ranks.clear();
+            ranks.reserve(words.size() / 8 + 1);
+            uint64_t cur = 0;
+            for(size_t i = 0; i < words.size(); i++) {
+                if(i % 8 == 0)
+                    ranks.push_back(cur);
+                cur += __builtin_popcountll(words[i]);
+            }
+        }
+
+//        Number of set bits strictly before position pos
+        size_t rank(size_t pos) const {
+            size_t word = pos >> 6u;
+            size_t res = ranks[word / 8];
+            for(size_t i = word / 8 * 8; i < word; i++)
+                res += __builtin_popcountll(words[i]);
+            return res + __builtin_popcountll(words[word] & ((uint64_t(1) << (pos & 63u)) - 1));
+        }
+
+        size_t memory() const {
+            return (words.size() + ranks.size()) * sizeof(uint64_t);
+        }
+    };
+
+/*
+ * Minimal perfect hash function in the style of BBHash: keys are thrown into a bit array of gamma * n bits,
+ * keys that collide are passed to the next level. Each level is built in parallel. Keys that still collide after
+ * max_levels levels are stored in an ordinary hash map. Lookup of a key that was not in the construction set returns
+ * an arbitrary index or size_t(-1) so callers must verify the key itself.
+ */
+    class MPHF {
+    private:
+        static constexpr double gamma = 2.0;
+        static constexpr size_t max_levels = 32;
+        RankedBitArray bits;
+        std::vector<size_t> level_offsets;
+        std::vector<size_t> level_sizes;
+        std::unordered_map<htype, size_t, alt_hasher<htype>> fallback;
+        size_t key_num = 0;
+
+        static size_t reduce(uint64_t hash, size_t size) {
+            return size_t((unsigned __int128)(hash) * size >> 64u);
+        }
+
+    public:
+        MPHF() = default;
+
+//        levels limits the number of bit array levels, keys left after them go to the fallback map
+        MPHF(const std::vector<htype> &keys, size_t threads, size_t levels = max_levels) : key_num(keys.size()) {
+            omp_set_num_threads(threads);
+            std::vector<htype> current = keys;
+            std::vector<htype> next;
+            size_t offset = 0;
+            for(size_t level = 0; level < levels && !current.empty(); level++) {
+                size_t level_size = std::max<size_t>(64, (size_t(current.size() * gamma) + 63) / 64 * 64);
+                RankedBitArray filled(level_size);
+                RankedBitArray collided(level_size);
+#pragma omp parallel for default(none) shared(current, filled, collided, level, level_size)
+                for(size_t i = 0; i < current.size(); i++) {
+                    size_t pos = reduce(seededHash(current[i], level), level_size);
+                    if(filled.atomicSet(pos))
+                        collided.atomicSet(pos);
+                }
+                std::vector<std::vector<htype>> left(threads);
+#pragma omp parallel for default(none) shared(current, collided, left, level, level_size)
+                for(size_t i = 0; i < current.size(); i++) {
+                    size_t pos = reduce(seededHash(current[i], level), level_size);
+                    if(collided.get(pos))
+                        left[omp_get_thread_num()].push_back(current[i]);
+                }
+                filled.subtract(collided);
+                bits.append(filled);
+                level_offsets.push_back(offset);
+                level_sizes.push_back(level_size);
+                offset += level_size;
+                next.clear();
+                for(std::vector<htype> &part : left)
+                    next.insert(next.end(), part.begin(), part.end());
+                std::swap(current, next);
+            }
+            bits.buildRank();
+            size_t placed = key_num - current.size();
+            for(size_t i = 0; i < current.size(); i++)
+                fallback[current[i]] = placed + i;
+        }
+
+        size_t size() const {return key_num;}
+        size_t fallbackSize() const {return fallback.size();}
+
+        size_t lookup(const htype &key) const {
+            for(size_t level = 0; level < level_sizes.size(); level++) {
+                size_t pos = level_offsets[level] + reduce(seededHash(key, level), level_sizes[level]);
+                if(bits.get(pos))
+                    return bits.rank(pos);
+            }
+            auto it = fallback.find(key);
+            if(it == fallback.end())
+                return size_t(-1);
+            return it->second;
+        }
+
+        size_t memory() const {
+            return bits.memory() + fallback.size() * (sizeof(htype) + sizeof(size_t)) * 2;
+        }
+    };
+
+/*
+ * Hash map from htype to V with a static part and a dynamic part. Static part is constructed once from a list of keys
+ * and stores values in a flat array indexed by a minimal perfect hash function. Keys added after construction go to
+ * an ordinary unordered_map. Values in both parts never move so pointers to them remain valid until erased.
+ * Values are constructed from their key. Erased static values are destroyed in place and skipped by iteration.
+ * With no static keys this class behaves exactly like std::unordered_map, including iteration order.
+ */
+    template<class V>
+    class PerfectHashMap {
+    public:
+        typedef std::pair<const htype, V> value_type;
+        typedef std::unordered_map<htype, V, alt_hasher<htype>> dynamic_map_type;
+    private:
+        struct Deleter {
+            size_t size = 0;
+            std::vector<bool> *alive = nullptr;
+            void operator()(value_type *ptr) const {
+                for(size_t i = 0; i < size; i++)
+                    if((*alive)[i])
+                        ptr[i].~value_type();
+                ::operator delete(static_cast<void *>(ptr));
+            }
+        };
+
+        MPHF mphf;
+        std::unique_ptr<std::vector<bool>> alive;
+        std::unique_ptr<value_type, Deleter> flat;
+        size_t static_size = 0;
+        size_t alive_num = 0;
+        dynamic_map_type dynamic;
+
+        value_type *findStatic(const htype &key) const {
+            if(static_size == 0)
+                return nullptr;
+            size_t ind = mphf.lookup(key);
+            if(ind >= static_size || !(*alive)[ind] || flat.get()[ind].first != key)
+                return nullptr;
+            return flat.get() + ind;
+        }
+
+    public:
+        template<class Value, class DynamicIterator>
+        class Iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Value value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef Value *pointer;
+            typedef Value &reference;
+        private:
+            friend class PerfectHashMap;
+            Value *flat;
+            const std::vector<bool> *alive;
+            size_t pos;
+            size_t static_size;
+            DynamicIterator it;
+
+            void seek() {
+                while(pos < static_size && !(*alive)[pos])
+                    pos++;
+            }
+        public:
+            Iterator() : flat(nullptr), alive(nullptr), pos(0), static_size(0), it() {}
+            Iterator(Value *flat, const std::vector<bool> *alive, size_t pos, size_t static_size, DynamicIterator it) :
+                    flat(flat), alive(alive), pos(pos), static_size(static_size), it(it) {
+                seek();
+            }
+
+            template<class OtherValue, class OtherIterator>
+            Iterator(const Iterator<OtherValue, OtherIterator> &other) : flat(other.flat), alive(other.alive),
+                            pos(other.pos), static_size(other.static_size), it(other.it) {
+            }
+
+            reference operator*() const {return pos < static_size ? flat[pos] : *it;}
+            pointer operator->() const {return &operator*();}
+
+            Iterator &operator++() {
+                if(pos < static_size) {
+                    pos++;
+                    seek();
+                } else {
+                    ++it;
+                }
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                Iterator other = *this;
+                ++*this;
+                return other;
+            }
+
+            bool operator==(const Iterator &other) const {
+                return pos == other.pos && (pos < static_size || it == other.it);
+            }
+            bool operator!=(const Iterator &other) const {return !operator==(other);}
+
+            template<class, class> friend class Iterator;
+        };
+
+        typedef Iterator<value_type, typename dynamic_map_type::iterator> iterator;
+        typedef Iterator<const value_type, typename dynamic_map_type::const_iterator> const_iterator;
+
+        PerfectHashMap() = default;
+
+//        keys must be distinct
+        PerfectHashMap(const std::vector<htype> &keys, size_t threads) : mphf(keys, threads),
+                    alive(new std::vector<bool>(keys.size(), true)), static_size(keys.size()), alive_num(keys.size()) {
+            auto *storage = static_cast<value_type *>(::operator new(sizeof(value_type) * std::max<size_t>(1, static_size)));
+            std::vector<size_t> order(static_size, size_t(-1));
+            omp_set_num_threads(threads);
+#pragma omp parallel for default(none) shared(keys, order)
+            for(size_t i = 0; i < keys.size(); i++) {
+                order[i] = mphf.lookup(keys[i]);
+            }
+#pragma omp parallel for default(none) shared(keys, order, storage)
+            for(size_t i = 0; i < keys.size(); i++) {
+                new(storage + order[i]) value_type(std::piecewise_construct, std::forward_as_tuple(keys[i]),
+                                                   std::forward_as_tuple(keys[i]));
+            }
+            flat = std::unique_ptr<value_type, Deleter>(storage, Deleter{static_size, alive.get()});
+        }
+
+        PerfectHashMap(PerfectHashMap &&other) = default;
+//        Deleter of flat reads alive, so the old flat array is released before alive is replaced
+        PerfectHashMap &operator=(PerfectHashMap &&other) noexcept {
+            if(this == &other)
+                return *this;
+            flat.reset();
+            mphf = std::move(other.mphf);
+            alive = std::move(other.alive);
+            flat = std::move(other.flat);
+            static_size = other.static_size;
+            alive_num = other.alive_num;
+            dynamic = std::move(other.dynamic);
+            other.static_size = 0;
+            other.alive_num = 0;
+            return *this;
+        }
+        PerfectHashMap(const PerfectHashMap &other) = delete;
+
+        size_t size() const {return alive_num + dynamic.size();}
+        bool empty() const {return size() == 0;}
+        size_t staticSize() const {return alive_num;}
+
+        iterator begin() {return iterator(flat.get(), alive.get(), 0, static_size, dynamic.begin());}
+        iterator end() {return iterator(flat.get(), alive.get(), static_size, static_size, dynamic.end());}
+        const_iterator begin() const {return const_iterator(flat.get(), alive.get(), 0, static_size, dynamic.begin());}
+        const_iterator end() const {return const_iterator(flat.get(), alive.get(), static_size, static_size, dynamic.end());}
+
+        iterator find(const htype &key) {
+            value_type *res = findStatic(key);
+            if(res != nullptr)
+                return iterator(flat.get(), alive.get(), res - flat.get(), static_size, dynamic.begin());
+            return iterator(flat.get(), alive.get(), static_size, static_size, dynamic.find(key));
+        }
+
+        const_iterator find(const htype &key) const {
+            value_type *res = findStatic(key);
+            if(res != nullptr)
+                return const_iterator(flat.get(), alive.get(), res - flat.get(), static_size, dynamic.begin());
+            return const_iterator(flat.get(), alive.get(), static_size, static_size, dynamic.find(key));
+        }
+
+//        Arguments are expected in the same form as for std::unordered_map::emplace with piecewise construction.
+        template<class... Args>
+        std::pair<iterator, bool> emplace(std::piecewise_construct_t pc, std::tuple<const htype &> key, Args &&... args) {
+            value_type *res = findStatic(std::get<0>(key));
+            if(res != nullptr)
+                return {iterator(flat.get(), alive.get(), res - flat.get(), static_size, dynamic.begin()), false};
+            auto it = dynamic.emplace(pc, key, std::forward<Args>(args)...);
+            return {iterator(flat.get(), alive.get(), static_size, static_size, it.first), it.second};
+        }
+
+        iterator erase(iterator it) {
+            if(it.pos < static_size) {
+                flat.get()[it.pos].~value_type();
+                (*alive)[it.pos] = false;
+                alive_num--;
+                ++it;
+                return it;
+            }
+            return iterator(flat.get(), alive.get(), static_size, static_size, dynamic.erase(it.it));
+        }
+    };
+}
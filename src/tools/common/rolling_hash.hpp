@@ -37,6 +37,10 @@ namespace hashing {
             return k;
         }
 
+        htype getBase() const {
+            return hbase;
+        }
+
         RollingHash extensionHash() const {
             return RollingHash(k + 1, hbase);
         }
@@ -50,13 +54,45 @@ namespace hashing {
         }
 
         htype extendRight(const Sequence &seq, size_t pos, htype hash, unsigned char c) const {
-            return hash * hbase + c;
+            return extendRight(hash, c);
         }
 
         htype extendLeft(const Sequence &seq, size_t pos, htype hash, unsigned char c) const {
+            return extendLeft(hash, c);
+        }
+
+        htype extendRight(htype hash, unsigned char c) const {
+            return hash * hbase + c;
+        }
+
+        htype extendLeft(htype hash, unsigned char c) const {
             return hash + c * kpow * hbase;
         }
 
+//        Hashes of all k-mers of the unpacked sequence nucls of length n are written to fhashes and hashes of their
+//        reverse complements to rhashes. Both arrays must have space for n - k + 1 values.
+        void hashAll(const unsigned char *nucls, size_t n, htype *fhashes, htype *rhashes) const {
+            VERIFY(n >= k);
+            const size_t m = n - k + 1;
+            const htype remove[4] = {0, kpow, kpow * 2, kpow * 3};
+            htype fhash = 0;
+            for (size_t i = 0; i < k; i++)
+                fhash = fhash * hbase + nucls[i];
+            fhashes[0] = fhash;
+            for (size_t i = 1; i < m; i++) {
+                fhash = (fhash - remove[nucls[i - 1]]) * hbase + nucls[i + k - 1];
+                fhashes[i] = fhash;
+            }
+            htype rhash = 0;
+            for (size_t i = n; i > n - k; i--)
+                rhash = rhash * hbase + (nucls[i - 1] ^ 3u);
+            rhashes[m - 1] = rhash;
+            for (size_t i = m - 1; i > 0; i--) {
+                rhash = (rhash - remove[nucls[i + k - 1] ^ 3u]) * hbase + (nucls[i - 1] ^ 3u);
+                rhashes[i - 1] = rhash;
+            }
+        }
+
         htype shiftRight(const Sequence &seq, size_t pos, htype hash, unsigned char c) const {
             return (hash - kpow * seq[pos]) * hbase + c;
         }
@@ -82,8 +118,11 @@ namespace hashing {
         }
     };
 
+    class KmerHashBuffer;
+
     class KWH {
     private:
+        friend class KmerHashBuffer;
         /**
          * @brief 构造函数，用于初始化 KWH 对象
          *
@@ -193,6 +232,84 @@ namespace hashing {
     };
 
 
+//    Hashes of one k-mer without a reference to its sequence. Gives the same values as KWH at the same position.
+    class HashedKmer {
+    private:
+        const RollingHash *hasher;
+        htype fhash;
+        htype rhash;
+    public:
+        size_t pos;
+
+        HashedKmer(const RollingHash &_hasher, size_t _pos, htype _fhash, htype _rhash) :
+                hasher(&_hasher), fhash(_fhash), rhash(_rhash), pos(_pos) {
+        }
+
+        htype hash() const {return std::min(fhash, rhash);}
+        htype fHash() const {return fhash;}
+        htype rHash() const {return rhash;}
+        bool isCanonical() const {return fhash < rhash;}
+
+        htype extendRight(unsigned char c) const {
+            return std::min(hasher->extendRight(fhash, c), hasher->extendLeft(rhash, c ^ 3u));
+        }
+
+        htype extendLeft(unsigned char c) const {
+            return std::min(hasher->extendLeft(fhash, c), hasher->extendRight(rhash, c ^ 3u));
+        }
+    };
+
+//    Computes hashes of all k-mers of a sequence in one pass over unpacked nucleotides instead of walking kwh.next().
+//    Buffers are reused between calls to fill so one object can be used for many sequences in the same thread.
+    class KmerHashBuffer {
+    private:
+        const RollingHash &hasher_;
+        Sequence seq_;
+        std::vector<unsigned char> nucls;
+        std::vector<htype> fhashes;
+        std::vector<htype> rhashes;
+    public:
+        explicit KmerHashBuffer(const RollingHash &hasher) : hasher_(hasher) {
+        }
+
+        KmerHashBuffer(const RollingHash &hasher, const Sequence &seq) : hasher_(hasher) {
+            fill(seq);
+        }
+
+        void fill(const Sequence &seq) {
+            seq_ = seq;
+            nucls.resize(seq.size());
+            seq.unpack(nucls.data());
+            if(seq.size() < hasher_.getK()) {
+                fhashes.clear();
+                rhashes.clear();
+                return;
+            }
+            fhashes.resize(seq.size() - hasher_.getK() + 1);
+            rhashes.resize(fhashes.size());
+            hasher_.hashAll(nucls.data(), nucls.size(), fhashes.data(), rhashes.data());
+        }
+
+//        Number of k-mers in the sequence
+        size_t size() const {return fhashes.size();}
+        const Sequence &seq() const {return seq_;}
+        const RollingHash &hasher() const {return hasher_;}
+        unsigned char nucl(size_t pos) const {return nucls[pos];}
+
+        htype hash(size_t pos) const {return std::min(fhashes[pos], rhashes[pos]);}
+        htype fHash(size_t pos) const {return fhashes[pos];}
+        htype rHash(size_t pos) const {return rhashes[pos];}
+        bool isCanonical(size_t pos) const {return fhashes[pos] < rhashes[pos];}
+
+        HashedKmer operator[](size_t pos) const {
+            return {hasher_, pos, fhashes[pos], rhashes[pos]};
+        }
+
+        KWH kwh(size_t pos) const {
+            return {hasher_, seq_, pos, fhashes[pos], rhashes[pos]};
+        }
+    };
+
     class MinQueue {
         std::deque<KWH> q;
     public:
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <omp.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+//Number of lock acquisitions that found the lock taken and number of wait iterations they made. Collected for all locks
+//of the same type together and only on the slow path so uncontended locking does not touch shared counters.
+struct LockStats {
+    size_t contended = 0;
+    size_t spins = 0;
+};
+
+//One byte test-and-test-and-set lock. Waiting threads spin on a plain load so that the cache line is not written until
+//the lock is released and yield to the scheduler after long waits. Locks are not recursive.
+class SpinLock {
+private:
+    std::atomic<uint8_t> locked{0};
+
+    static std::atomic<size_t> &contendedCounter() {
+        static std::atomic<size_t> res(0);
+        return res;
+    }
+
+    static std::atomic<size_t> &spinCounter() {
+        static std::atomic<size_t> res(0);
+        return res;
+    }
+
+    static void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    void lockContended() {
+        size_t spins = 0;
+        do {
+            while(locked.load(std::memory_order_relaxed) != 0) {
+                spins++;
+                if(spins % 1024 == 0)
+                    std::this_thread::yield();
+                else
+                    pause();
+            }
+        } while(locked.exchange(1, std::memory_order_acquire) != 0);
+        contendedCounter().fetch_add(1, std::memory_order_relaxed);
+        spinCounter().fetch_add(spins, std::memory_order_relaxed);
+    }
+
+public:
+    SpinLock() = default;
+    SpinLock(const SpinLock &) = delete;
+    SpinLock &operator=(const SpinLock &) = delete;
+
+    void lock() {
+        if(locked.exchange(1, std::memory_order_acquire) != 0)
+            lockContended();
+    }
+
+    bool try_lock() {
+        return locked.load(std::memory_order_relaxed) == 0 && locked.exchange(1, std::memory_order_acquire) == 0;
+    }
+
+    void unlock() {
+        locked.store(0, std::memory_order_release);
+    }
+
+    static LockStats Stats() {
+        LockStats res;
+        res.contended = contendedCounter().load();
+        res.spins = spinCounter().load();
+        return res;
+    }
+
+    static void ResetStats() {
+        contendedCounter() = 0;
+        spinCounter() = 0;
+    }
+};
+
+//omp_lock_t with the same interface as SpinLock. Only contended acquisitions are counted since waiting happens inside
+//the OpenMP runtime.
+class OmpLock {
+private:
+    omp_lock_t lock_ = {};
+
+    static std::atomic<size_t> &contendedCounter() {
+        static std::atomic<size_t> res(0);
+        return res;
+    }
+
+public:
+    OmpLock() {omp_init_lock(&lock_);}
+    ~OmpLock() {omp_destroy_lock(&lock_);}
+    OmpLock(const OmpLock &) = delete;
+    OmpLock &operator=(const OmpLock &) = delete;
+
+    void lock() {
+        if(!omp_test_lock(&lock_)) {
+            contendedCounter().fetch_add(1, std::memory_order_relaxed);
+            omp_set_lock(&lock_);
+        }
+    }
+
+    bool try_lock() {return omp_test_lock(&lock_);}
+    void unlock() {omp_unset_lock(&lock_);}
+
+    static LockStats Stats() {
+        LockStats res;
+        res.contended = contendedCounter().load();
+        return res;
+    }
+
+    static void ResetStats() {
+        contendedCounter() = 0;
+    }
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <experimental/filesystem>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace logging {
+
+//Measures wall time, cpu time, peak RSS and amount of processed data of a pipeline stage. Timers nest: a timer created
+//while another one is alive becomes its child and its name is prefixed with the parent name. When a timer finishes it
+//appends one JSON line to the stage file so that stages that run in forked processes are reported too. Processes
+//created with fork inherit the stage file and the enclosing timer. cpu time includes finished child processes and peak
+//RSS of nested stages is added to their parents when the report is written.
+//processRecords reports number and total length of processed records to all running timers.
+    class StageTimer {
+    private:
+        std::string name;
+        StageTimer *parent;
+        timespec start{};
+        double start_cpu;
+        size_t items = 0;
+        size_t bases = 0;
+        size_t peak_rss_kb = 0;
+        double wall = 0;
+        double cpu = 0;
+        bool finished = false;
+
+        static StageTimer *&current() {
+            static StageTimer *res = nullptr;
+            return res;
+        }
+
+        static std::string &stageFile() {
+            static std::string res;
+            return res;
+        }
+
+        static double cpuTime() {
+            double res = 0;
+            for(int who : {RUSAGE_SELF, RUSAGE_CHILDREN}) {
+                struct rusage usage{};
+                getrusage(who, &usage);
+                res += double(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+                        double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+            }
+            return res;
+        }
+
+//        Peak RSS of this process since last reset in kb. Reads VmHWM and falls back to getrusage.
+        static size_t peakRss() {
+            std::ifstream is("/proc/self/status");
+            std::string line;
+            while(std::getline(is, line)) {
+                if(line.compare(0, 6, "VmHWM:") == 0)
+                    return std::stoull(line.substr(6));
+            }
+            struct rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+            return usage.ru_maxrss;
+        }
+
+//        Makes VmHWM track peak of the stage instead of the whole process. Ignored if the kernel does not support it.
+        static void resetPeakRss() {
+            int fd = open("/proc/self/clear_refs", O_WRONLY);
+            if(fd >= 0) {
+                if(write(fd, "5", 1) < 0) {
+                }
+                close(fd);
+            }
+        }
+
+        static std::string escape(const std::string &s) {
+            std::string res;
+            for(char c : s) {
+                if(c == '"' || c == '\\')
+                    res += '\\';
+                res += c;
+            }
+            return res;
+        }
+
+    public:
+        explicit StageTimer(const std::string &_name) : parent(current()), start_cpu(cpuTime()) {
+            name = parent == nullptr ? _name : parent->name + "/" + _name;
+            if(parent != nullptr)
+                parent->peak_rss_kb = std::max(parent->peak_rss_kb, peakRss());
+            resetPeakRss();
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            current() = this;
+        }
+
+        StageTimer(const StageTimer &) = delete;
+        StageTimer &operator=(const StageTimer &) = delete;
+
+        ~StageTimer() {
+            finish();
+        }
+
+//        All timers of this process write records to the given file. The file is truncated.
+        static void SetStageFile(const std::experimental::filesystem::path &fname) {
+            stageFile() = fname.string();
+            std::ofstream os(fname);
+        }
+
+        static void Count(size_t items, size_t bases) {
+            for(StageTimer *timer = current(); timer != nullptr; timer = timer->parent) {
+                timer->items += items;
+                timer->bases += bases;
+            }
+        }
+
+//        Measured values. Times and peak RSS are only available after finish.
+        double wallSec() const {return wall;}
+        double cpuSec() const {return cpu;}
+        double peakRssMb() const {return double(peak_rss_kb) / 1024;}
+        size_t itemsProcessed() const {return items;}
+        size_t basesProcessed() const {return bases;}
+
+        void finish() {
+            if(finished)
+                return;
+            finished = true;
+            timespec finish{};
+            clock_gettime(CLOCK_MONOTONIC, &finish);
+            wall = double(finish.tv_sec - start.tv_sec) + double(finish.tv_nsec - start.tv_nsec) / 1000000000.0;
+            cpu = cpuTime() - start_cpu;
+            peak_rss_kb = std::max(peak_rss_kb, peakRss());
+            if(current() == this)
+                current() = parent;
+            if(parent != nullptr)
+                parent->peak_rss_kb = std::max(parent->peak_rss_kb, peak_rss_kb);
+            if(stageFile().empty())
+                return;
+            std::stringstream ss;
+            ss << "{\"stage\": \"" << escape(name) << "\", \"pid\": " << getpid() << ", \"wall_sec\": " << wall
+               << ", \"cpu_sec\": " << cpu << ", \"peak_rss_mb\": " << double(peak_rss_kb) / 1024
+               << ", \"items\": " << items << ", \"bases\": " << bases
+               << ", \"items_per_sec\": " << (wall > 0 ? double(items) / wall : 0)
+               << ", \"bases_per_sec\": " << (wall > 0 ? double(bases) / wall : 0) << "}\n";
+            std::string line = ss.str();
+            int fd = open(stageFile().c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+            if(fd >= 0) {
+                if(write(fd, line.c_str(), line.size()) < 0) {
+                }
+                close(fd);
+            }
+        }
+
+//        Collects all records of the stage file into a single JSON document in the order stages finished. Peak RSS of
+//        a stage is raised to the peak of its nested stages since those could run in forked processes.
+        static void WriteReport(const std::experimental::filesystem::path &fname) {
+            if(stageFile().empty())
+                return;
+            const std::string name_key = "{\"stage\": \"";
+            const std::string peak_key = "\"peak_rss_mb\": ";
+            std::vector<std::string> lines;
+            std::vector<std::string> names;
+            std::vector<double> peaks;
+            std::ifstream is(stageFile());
+            std::string line;
+            while(std::getline(is, line)) {
+                size_t name_pos = line.find(name_key);
+                size_t peak_pos = line.find(peak_key);
+                if(name_pos != 0 || peak_pos == size_t(-1))
+                    continue;
+                lines.push_back(line);
+                names.push_back(line.substr(name_key.size(), line.find("\", ", name_key.size()) - name_key.size()));
+                peaks.push_back(std::stod(line.substr(peak_pos + peak_key.size())));
+            }
+            std::ofstream os(fname);
+            os << "{\n  \"stages\": [";
+            for(size_t i = 0; i < lines.size(); i++) {
+                double peak = peaks[i];
+                for(size_t j = 0; j < lines.size(); j++) {
+                    if(names[j].compare(0, names[i].size() + 1, names[i] + "/") == 0)
+                        peak = std::max(peak, peaks[j]);
+                }
+                size_t from = lines[i].find(peak_key) + peak_key.size();
+                size_t to = lines[i].find(',', from);
+                std::stringstream ss;
+                ss << peak;
+                os << (i == 0 ? "\n    " : ",\n    ") << lines[i].substr(0, from) << ss.str() << lines[i].substr(to);
+            }
+            os << "\n  ]\n}\n";
+        }
+    };
+}
@@ -0,0 +1,128 @@
+//
+// Read-only map from 128-bit k-mer hashes to small values stored in one sorted array.
+//
+
+#pragma once
+#include "hash_utils.hpp"
+#include "verify.hpp"
+#include <omp.h>
+#include <parallel/algorithm>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace hashing {
+/*
+ * Records are sorted by a mixed 64-bit key and a directory indexed by the top bits of that key stores where each
+ * bucket starts. The directory has about one bucket per record so a lookup reads one directory entry and usually
+ * one record. The index is built in bulk and is rebuilt when records are added. On duplicate hashes the record that
+ * was inserted first is kept.
+ */
+    template<class V>
+    class StaticHashIndex {
+    public:
+        typedef std::pair<htype, V> value_type;
+        typedef typename std::vector<value_type>::const_iterator const_iterator;
+    private:
+//        Number of records looked up in advance by findAll
+        static constexpr size_t prefetch_distance = 8;
+        std::vector<value_type> records;
+        std::vector<uint32_t> directory;
+        size_t shift = 64;
+
+        static uint64_t key(const htype &hash) {return seededHash(hash, 0);}
+
+        size_t bucket(const htype &hash) const {return shift == 64 ? 0 : size_t(key(hash) >> shift);}
+
+    public:
+        StaticHashIndex() = default;
+        StaticHashIndex(StaticHashIndex &&other) = default;
+        StaticHashIndex &operator=(StaticHashIndex &&other) = default;
+        StaticHashIndex(const StaticHashIndex &other) = delete;
+
+        size_t size() const {return records.size();}
+        bool empty() const {return records.empty();}
+        const_iterator begin() const {return records.begin();}
+        const_iterator end() const {return records.end();}
+
+        void clear() {
+            records = {};
+            directory = {};
+            shift = 64;
+        }
+
+        void insert(std::vector<value_type> added, size_t threads) {
+            VERIFY(records.size() + added.size() < size_t(uint32_t(-1)));
+            omp_set_num_threads(threads);
+            records.insert(records.end(), added.begin(), added.end());
+            added = {};
+            __gnu_parallel::stable_sort(records.begin(), records.end(),
+                                        [](const value_type &a, const value_type &b) {
+                uint64_t ka = key(a.first);
+                uint64_t kb = key(b.first);
+                return ka < kb || (ka == kb && a.first < b.first);
+            });
+            records.erase(std::unique(records.begin(), records.end(),
+                                      [](const value_type &a, const value_type &b) {return a.first == b.first;}),
+                          records.end());
+            records.shrink_to_fit();
+            size_t bits = 0;
+            while((size_t(1) << bits) < records.size())
+                bits++;
+            shift = 64 - bits;
+            size_t buckets = size_t(1) << bits;
+            directory.resize(buckets + 1);
+#pragma omp parallel for default(none) shared(buckets)
+            for(size_t b = 0; b <= buckets; b++) {
+                directory[b] = uint32_t(std::partition_point(records.begin(), records.end(),
+                                                             [this, b](const value_type &rec) {
+                    return bucket(rec.first) < b;
+                }) - records.begin());
+            }
+        }
+
+        const V *find(const htype &hash) const {
+            if(records.empty())
+                return nullptr;
+            size_t b = bucket(hash);
+            for(size_t i = directory[b], e = directory[b + 1]; i < e; i++) {
+                if(records[i].first == hash)
+                    return &records[i].second;
+            }
+            return nullptr;
+        }
+
+        bool contains(const htype &hash) const {return find(hash) != nullptr;}
+
+//        Loads the directory entry of the bucket of hash into cache. Records can not be prefetched without reading the
+//        entry so findAll prefetches them later, after the entry had time to arrive.
+        void prefetch(const htype &hash) const {
+            if(records.empty())
+                return;
+            __builtin_prefetch(&directory[bucket(hash)]);
+        }
+
+//        Writes find(*it) to out for each hash in the range. Directory entries are prefetched 2 * prefetch_distance
+//        hashes ahead and records prefetch_distance hashes ahead so that lookups of different hashes overlap.
+        template<class I, class O>
+        O findAll(I begin, I end, O out) const {
+            size_t n = end - begin;
+            for(size_t i = 0; i < n; i++) {
+                if(i + 2 * prefetch_distance < n)
+                    prefetch(begin[i + 2 * prefetch_distance]);
+                if(!records.empty() && i + prefetch_distance < n) {
+                    size_t first = directory[bucket(begin[i + prefetch_distance])];
+                    __builtin_prefetch(&records[std::min(first, records.size() - 1)]);
+                }
+                *out = find(begin[i]);
+                ++out;
+            }
+            return out;
+        }
+
+        size_t memory() const {
+            return records.capacity() * sizeof(value_type) + directory.capacity() * sizeof(uint32_t);
+        }
+    };
+}
@@ -28,6 +28,20 @@ void StringContig::compress() {
     seq.erase(std::unique(seq.begin(), seq.end()), seq.end());
 
     // 使用std::unique函数去除seq中连续的重复元素
+    seq.resize(compressDimers(&seq[0], seq.size()));
+}
+
+/**
+ * @brief 压缩二核苷酸重复
+ *
+ * 将长度超过min_dimer_to_compress的二核苷酸重复截短到max_dimer_size以内。
+ *
+ * @param seq 已经过同聚物压缩的序列
+ * @param size 序列长度
+ *
+ * @return 压缩后的序列长度
+ */
+size_t StringContig::compressDimers(char *seq, size_t size) {
     VERIFY(min_dimer_to_compress <= max_dimer_size);
     VERIFY(min_dimer_to_compress >= 4);
     VERIFY(dimer_step == 1);
@@ -35,16 +49,16 @@ void StringContig::compress() {
     // 验证min_dimer_to_compress是否在max_dimer_size的范围内
     // 验证min_dimer_to_compress是否大于等于4
     // 验证dimer_step是否等于1
-    if(min_dimer_to_compress >= seq.size())
-        return;
+    if(min_dimer_to_compress >= size)
+        return size;
 
     // 如果min_dimer_to_compress大于等于seq的大小，则直接返回，不进行压缩操作
     size_t cur = 2;
     size_t at_len = 2;
 
     // 定义当前位置和连续相同元素的长度
-    for(size_t i = 2; i <= seq.size(); i++) {
-        if (i < seq.size() && seq[i] == seq[cur - 2]) {
+    for(size_t i = 2; i <= size; i++) {
+        if (i < size && seq[i] == seq[cur - 2]) {
             seq[cur] = seq[i];
             cur++;
             at_len += 1;
@@ -65,13 +79,45 @@ void StringContig::compress() {
             at_len = 2;
 
             // 调整当前位置和连续相同元素的长度
-            if(i < seq.size()) {
+            if(i < size) {
                 seq[cur] = seq[i];
                 cur++;
             }
         }
     }
-    seq.erase(seq.begin() + cur, seq.end());
+    return cur;
+}
 
-    // 移除seq中从当前位置到末尾的元素
+/**
+ * @brief 由映射文件中的字节构造序列
+ *
+ * 一次遍历完成大写转换和同聚物压缩，随后压缩二核苷酸重复并直接写入2比特编码的缓冲区，不创建中间的std::string记录。
+ *
+ * @return 压缩后的序列
+ */
+Sequence ContigView::makeSequence() const {
+    static thread_local std::string buf;
+    buf.resize(seq_size);
+    size_t len = 0;
+    for(size_t i = 0; i < seq_size; i++) {
+        char c = seq_ptr[i];
+        if('a' <= c && c <= 'z')
+            c += 'A' - 'a';
+        if(StringContig::homopolymer_compressing && len > 0 && buf[len - 1] == c)
+            continue;
+        buf[len] = c;
+        len++;
+    }
+    if(StringContig::homopolymer_compressing)
+        len = StringContig::compressDimers(&buf[0], len);
+    return Sequence::fromPacked(len, [len](uint64_t *out) {
+        const size_t words = (len + 31) / 32;
+        for(size_t w = 0; w < words; w++) {
+            uint64_t word = 0;
+            size_t to = std::min(len, w * 32 + 32);
+            for(size_t i = to; i > w * 32; i--)
+                word = (word << 2u) | uint64_t(dignucl(buf[i - 1]) & 3);
+            out[w] = word;
+        }
+    });
 }
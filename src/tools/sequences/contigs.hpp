@@ -296,6 +296,9 @@ public:
 
     void compress();
 
+//    Compresses long dinucleotide repeats of an already homopolymer compressed sequence in place and returns its new size
+    static size_t compressDimers(char *seq, size_t size);
+
 //    void atCompress() {
 //        size_t cur = 0;
 //        size_t at_len = 0;
@@ -340,7 +343,59 @@ public:
     }
 };
 
+//Read record that refers to the bytes of a memory mapped file instead of owning copies of its id and sequence.
+//Sequence is upper cased, compressed and packed into a Sequence in one pass with the same result as StringContig.
+//Records with sequence split over several lines keep the joined sequence in shared storage.
+class ContigView {
+private:
+    const char *id_ptr = nullptr;
+    size_t id_size = 0;
+    const char *seq_ptr = nullptr;
+    size_t seq_size = 0;
+    size_t offset = 0;
+    bool chunk = false;
+    std::shared_ptr<const std::string> storage;
+public:
+    ContigView() = default;
+
+    ContigView(const char *id_ptr, size_t id_size, const char *seq_ptr, size_t seq_size, size_t offset, bool chunk,
+               std::shared_ptr<const std::string> storage) :
+            id_ptr(id_ptr), id_size(id_size), seq_ptr(seq_ptr), seq_size(seq_size), offset(offset), chunk(chunk),
+            storage(std::move(storage)) {
+    }
+
+//    For parts of long reads this is the read id followed by start position of the part as in SeqReader
+    std::string getId() const {
+        std::string res(id_ptr, id_size);
+        if(chunk)
+            res += "_" + std::to_string(offset);
+        return std::move(res);
+    }
+
+    Sequence makeSequence() const;
+
+    Contig makeContig() const {
+        return Contig(makeSequence(), getId());
+    }
+
+//    Sequence in upper case without compression, same as seq of StringContig
+    std::string seqString() const {
+        std::string res(seq_ptr, seq_size);
+        for(char &c : res) {
+            if('a' <= c && c <= 'z')
+                c += 'A' - 'a';
+        }
+        return std::move(res);
+    }
+
+    bool isNull() const {
+        return id_size == 0 && seq_size == 0;
+    }
 
+    size_t size() const {
+        return seq_size;
+    }
+};
 
 template <class T>
 class SequenceCollection {
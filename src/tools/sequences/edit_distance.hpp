@@ -3,16 +3,10 @@
 #include "sequences/sequence.hpp"
 
 inline size_t edit_distance(Sequence s1, Sequence s2) {
-    size_t left_skip = 0;
-    while(left_skip < s1.size() && left_skip < s2.size() && s1[left_skip] == s2[left_skip]) {
-        left_skip++;
-    }
+    size_t left_skip = s1.commonPrefix(s2);
     s1 = s1.Subseq(left_skip, s1.size());
     s2 = s2.Subseq(left_skip, s2.size());
-    size_t right_skip = 0;
-    while(right_skip < s1.size() && right_skip < s2.size() && s1[s1.size() - 1 - right_skip] == s2[s2.size() - 1 - right_skip]) {
-        right_skip++;
-    }
+    size_t right_skip = s1.commonSuffix(s2);
     s1 = s1.Subseq(0, s1.size() - right_skip);
     s2 = s2.Subseq(0, s2.size() - right_skip);
     std::vector<std::vector<size_t>> d(s1.size() + 1, std::vector<size_t>(s2.size() + 1));
@@ -3,12 +3,16 @@
 #include "common/string_utils.hpp"
 #include "stream.hpp"
 #include "contigs.hpp"
+#include "common/bounded_queue.hpp"
+#include "common/mmap_utils.hpp"
 #include <experimental/filesystem>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 #include <functional>
+#include <thread>
 #include <utility>
 
 namespace io {
@@ -27,13 +31,13 @@ namespace io {
         return res;
     }
 
-    template<class Reader>
+    template<class Reader, class Value = StringContig>
     class ContigIterator {
     private:
         Reader &reader;
         bool isend;
     public:
-        typedef StringContig value_type;
+        typedef Value value_type;
 
         ContigIterator(Reader &_reader, bool _isend) : reader(_reader), isend(_isend) {
             if(reader.eof()) {
@@ -48,7 +52,7 @@ namespace io {
             }
         }
 
-        StringContig operator*() {
+        Value operator*() {
             return reader.get();
         }
 
@@ -164,7 +168,7 @@ namespace io {
                 }
                 VERIFY(std::experimental::filesystem::is_regular_file(file_name));
                 if (endsWith(file_name, ".gz")) {
-                    stream = new gzstream::igzstream(file_name.c_str());
+                    stream = new gzstream::ipipegzstream(file_name.c_str());
                     fastq = endsWith(file_name, "fastq.gz") or endsWith(file_name, "fq.gz");
                 } else {
                     stream = new std::ifstream(file_name);
@@ -279,6 +283,290 @@ namespace io {
         }
     };
 
+//    Reads records of a SeqReader on a separate parser thread. Parsed records are passed to the consuming thread in
+//    batches of total length about batch_length through a bounded queue, so the thread that distributes records between
+//    workers (e.g. the producer in ParallelProcessor::processRecords) never waits for parsing or decompression.
+    class PipelinedSeqReader {
+    public:
+        typedef ContigIterator<PipelinedSeqReader> Iterator;
+    private:
+        SeqReader reader;
+        size_t batch_length;
+        BoundedQueue<std::vector<StringContig>> batches;
+        std::vector<StringContig> batch;
+        size_t batch_pos = 0;
+        std::thread parser;
+
+        void parse() {
+            while(!reader.eof()) {
+                std::vector<StringContig> next_batch;
+                size_t len = 0;
+                while(!reader.eof() && len < batch_length) {
+                    next_batch.emplace_back(reader.read());
+                    len += next_batch.back().size();
+                }
+                if(!batches.push(std::move(next_batch)))
+                    break;
+            }
+            batches.close();
+        }
+
+        void inner_read() {
+            batch_pos += 1;
+            while(batch_pos >= batch.size()) {
+                batch.clear();
+                batch_pos = 0;
+                if(!batches.pop(batch))
+                    return;
+            }
+        }
+
+    public:
+        friend class ContigIterator<PipelinedSeqReader>;
+
+        explicit PipelinedSeqReader(Library _lib, size_t _min_read_size = size_t(-1) / 2, size_t _overlap = size_t(-1) / 8,
+                                    size_t _batch_length = 1 << 24, size_t queue_size = 4) :
+                reader(std::move(_lib), _min_read_size, _overlap), batch_length(_batch_length), batches(queue_size) {
+            parser = std::thread(&PipelinedSeqReader::parse, this);
+            batch_pos = size_t(-1);
+            inner_read();
+        }
+
+        explicit PipelinedSeqReader(const std::experimental::filesystem::path & file_name,
+                                    size_t _min_read_size = size_t(-1) / 2, size_t _overlap = size_t(-1) / 8) :
+                PipelinedSeqReader(Library({file_name}), _min_read_size, _overlap) {
+        }
+
+        PipelinedSeqReader(const PipelinedSeqReader &) = delete;
+
+        ContigIterator<PipelinedSeqReader> begin() {
+            return {*this, false};
+        }
+
+        ContigIterator<PipelinedSeqReader> end() {
+            return {*this, true};
+        }
+
+        StringContig get() {
+            return std::move(batch[batch_pos]);
+        }
+
+        StringContig read() {
+            StringContig tmp = get();
+            inner_read();
+            return std::move(tmp);
+        }
+
+        bool eof() const {
+            return batch_pos >= batch.size();
+        }
+
+        ~PipelinedSeqReader() {
+            batches.close();
+            parser.join();
+        }
+    };
+
+//    Reader of uncompressed FASTA/FASTQ files that maps all files into memory and hands out ContigView records pointing
+//    into the mapping. Record boundaries are found with memchr which scans for newlines a vector register at a time.
+//    Long reads are split into overlapping parts in the same way as in SeqReader.
+    class MappedSeqReader {
+    public:
+        typedef ContigIterator<MappedSeqReader, ContigView> Iterator;
+    private:
+        std::vector<MappedFile> files;
+        size_t file_ind = 0;
+        const char *pos = nullptr;
+        const char *file_end = nullptr;
+        size_t min_read_size;
+        size_t overlap;
+        ContigView next{};
+        const char *id_ptr = nullptr;
+        size_t id_size = 0;
+        const char *seq_ptr = nullptr;
+        size_t seq_size = 0;
+        std::shared_ptr<const std::string> storage;
+        size_t cur_start = 0;
+        size_t cur_end = 0;
+
+        static bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+        }
+
+//        Returns end of the line starting at pos and moves pos to the start of the next line
+        const char *readLine(const char *&line) {
+            line = pos;
+            const char *eol = static_cast<const char *>(memchr(pos, '\n', file_end - pos));
+            if(eol == nullptr)
+                eol = file_end;
+            pos = eol == file_end ? file_end : eol + 1;
+            while(eol > line && isSpace(eol[-1]))
+                eol--;
+            return eol;
+        }
+
+        bool readRecord() {
+            while(file_ind < files.size()) {
+                const char *line;
+                const char *eol = readLine(line);
+                while(line < eol && isSpace(*line))
+                    line++;
+                if(line == eol) {
+                    if(pos == file_end)
+                        nextFile();
+                    continue;
+                }
+                VERIFY(*line == '>' || *line == '@');
+                bool fastq = *line == '@';
+                id_ptr = line + 1;
+                while(id_ptr < eol && isSpace(*id_ptr))
+                    id_ptr++;
+                const char *id_end = id_ptr;
+                while(id_end < eol && *id_end != ' ')
+                    id_end++;
+                id_size = id_end - id_ptr;
+                seq_ptr = nullptr;
+                seq_size = 0;
+                storage.reset();
+                std::string joined;
+                while(pos < file_end && *pos != (fastq ? '+' : '>')) {
+                    const char *seq_end = readLine(line);
+                    if(line == seq_end)
+                        continue;
+                    if(seq_ptr == nullptr) {
+                        seq_ptr = line;
+                        seq_size = seq_end - line;
+                    } else {
+                        if(joined.empty())
+                            joined.assign(seq_ptr, seq_size);
+                        joined.append(line, seq_end);
+                    }
+                }
+                if(!joined.empty()) {
+                    storage = std::make_shared<const std::string>(std::move(joined));
+                    seq_ptr = storage->data();
+                    seq_size = storage->size();
+                }
+                if(fastq && pos < file_end) {
+                    readLine(line);
+                    size_t qlen = 0;
+                    while(pos < file_end && qlen < seq_size) {
+                        const char *qual_end = readLine(line);
+                        if(line == qual_end)
+                            break;
+                        qlen += qual_end - line;
+                    }
+                }
+                if(pos == file_end)
+                    nextFile();
+                if(seq_size == 0)
+                    continue;
+                return true;
+            }
+            return false;
+        }
+
+        void nextFile() {
+            file_ind++;
+            if(file_ind < files.size()) {
+                pos = files[file_ind].data();
+                file_end = pos + files[file_ind].size();
+            }
+        }
+
+        void choose_next_pos(size_t start) {
+            cur_start = start;
+            if(seq_size > start + 2 * min_read_size - overlap) {
+                cur_end = start + min_read_size;
+            } else {
+                cur_end = seq_size;
+            }
+            next = ContigView(id_ptr, id_size, seq_ptr + cur_start, cur_end - cur_start, cur_start,
+                              cur_start != 0 || cur_end != seq_size, storage);
+        }
+
+        void inner_read() {
+            if(cur_end > 0 && cur_end < seq_size) {
+                choose_next_pos(cur_end - overlap);
+                return;
+            }
+            if(readRecord()) {
+                choose_next_pos(0);
+            } else {
+                next = ContigView();
+                seq_size = 0;
+                cur_start = 0;
+                cur_end = 0;
+            }
+        }
+
+    public:
+        friend class ContigIterator<MappedSeqReader, ContigView>;
+
+//        Returns true if all files of the library can be read by this reader, i.e. none of them is compressed
+        static bool Supports(const Library &lib) {
+            for(const std::experimental::filesystem::path &file_name : lib) {
+                if(endsWith(file_name, ".gz"))
+                    return false;
+            }
+            return true;
+        }
+
+        explicit MappedSeqReader(const Library &lib, size_t _min_read_size = size_t(-1) / 2, size_t _overlap = size_t(-1) / 8) :
+                min_read_size(_min_read_size), overlap(_overlap) {
+            VERIFY(min_read_size >= overlap * 2);
+            for(const std::experimental::filesystem::path &file_name : lib) {
+                if(!std::experimental::filesystem::is_regular_file(file_name)) {
+                    std::cerr << "Error: file does not exist " << file_name << std::endl;
+                }
+                VERIFY(std::experimental::filesystem::is_regular_file(file_name));
+                files.emplace_back(file_name);
+                files.back().adviseSequential();
+            }
+            file_ind = size_t(-1);
+            nextFile();
+            inner_read();
+        }
+
+        MappedSeqReader(const MappedSeqReader &) = delete;
+
+        Iterator begin() {
+            return {*this, false};
+        }
+
+        Iterator end() {
+            return {*this, true};
+        }
+
+        ContigView get() const {
+            return next;
+        }
+
+        ContigView read() {
+            ContigView tmp = get();
+            inner_read();
+            return std::move(tmp);
+        }
+
+        bool eof() const {
+            return next.isNull();
+        }
+    };
+
+//    Calls f(begin, end) with iterators over all records of lib. Uncompressed libraries are read by MappedSeqReader and
+//    yield ContigView records, other libraries are read by PipelinedSeqReader and yield StringContig records, so f has to
+//    accept both.
+    template<class F>
+    void ReadLibrary(const Library &lib, F f, size_t min_read_size = size_t(-1) / 2, size_t overlap = size_t(-1) / 8) {
+        if(MappedSeqReader::Supports(lib)) {
+            MappedSeqReader reader(lib, min_read_size, overlap);
+            f(reader.begin(), reader.end());
+        } else {
+            PipelinedSeqReader reader(lib, min_read_size, overlap);
+            f(reader.begin(), reader.end());
+        }
+    }
+
 }
 
 inline io::Library operator+(const io::Library &lib1, const io::Library &lib2) {
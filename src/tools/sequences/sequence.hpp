@@ -6,9 +6,11 @@
 #include "IntrusiveRefCntPtr.h"
 #include "common/verify.hpp"
 #include <functional>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <memory>
+#include <atomic>
 #include <cstring>
 #include <sstream>
 
@@ -27,6 +29,76 @@ struct log_<0, base> {
     const static size_t value = 0;
 };
 
+//Bump allocator for short lived sequences. While a SequenceArena::Scope is alive on a thread, small sequence buffers
+//created by this thread are placed in the thread's arena and use a non-atomic reference count. The memory is reused
+//when the scope ends, so sequences created inside a scope must neither outlive it nor be copied by other threads.
+//This is checked when the scope is closed.
+class SequenceArena {
+private:
+    friend class Sequence;
+    static constexpr size_t BLOCK_SIZE = size_t(1) << 20u;
+//    Larger buffers are allocated on the heap even inside a scope
+    static constexpr size_t MAX_ALLOCATION = BLOCK_SIZE / 16;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block = 0;
+    size_t used = 0;
+    size_t live = 0;
+
+    SequenceArena() = default;
+
+    static SequenceArena &local() {
+        thread_local SequenceArena arena;
+        return arena;
+    }
+
+    static SequenceArena *&current() {
+        thread_local SequenceArena *res = nullptr;
+        return res;
+    }
+
+    void *allocate(size_t bytes) {
+        bytes = (bytes + 7u) & ~size_t(7u);
+        if (used + bytes > BLOCK_SIZE) {
+            block++;
+            used = 0;
+        }
+        if (block == blocks.size())
+            blocks.emplace_back(new char[BLOCK_SIZE]);
+        void *res = blocks[block].get() + used;
+        used += bytes;
+        live++;
+        return res;
+    }
+
+public:
+    SequenceArena(const SequenceArena &) = delete;
+    SequenceArena &operator=(const SequenceArena &) = delete;
+
+    class Scope {
+    private:
+        SequenceArena &arena;
+        SequenceArena *prev;
+        size_t block;
+        size_t used;
+        size_t live;
+    public:
+        Scope() : arena(local()), prev(current()), block(arena.block), used(arena.used), live(arena.live) {
+            current() = &arena;
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope() {
+            VERIFY_MSG(arena.live == live, "Sequence allocated in arena outlived its scope");
+            arena.block = block;
+            arena.used = used;
+            current() = prev;
+        }
+    };
+};
+
 class Sequence {
     // Type to store Seq in Sequences
     typedef u_int64_t ST;
@@ -37,26 +109,51 @@ class Sequence {
     // Number of bits in STN (for faster div and mod)
     const static size_t STNBits = log_<STN, 2>::value;
 
-    class ManagedNuclBuffer final : public llvm::ThreadSafeRefCountedBase<ManagedNuclBuffer> {
+    //Reference counted header followed by the packed nucleotides in the same allocation. Buffers placed in an arena
+    //count references without atomics and are never freed individually.
+    class ManagedNuclBuffer final {
+    private:
+        mutable std::atomic<int> ref_count;
+        SequenceArena *arena;
+
+        explicit ManagedNuclBuffer(SequenceArena *arena) : ref_count(0), arena(arena) {}
+
     public:
-        explicit ManagedNuclBuffer(size_t nucls) : _data(new ST[Sequence::DataSize(nucls)]) {
+        static ManagedNuclBuffer *create(size_t nucls) {
+            size_t bytes = sizeof(ManagedNuclBuffer) + Sequence::DataSize(nucls) * sizeof(ST);
+            SequenceArena *arena = SequenceArena::current();
+            if (arena != nullptr && bytes <= SequenceArena::MAX_ALLOCATION)
+                return new(arena->allocate(bytes)) ManagedNuclBuffer(arena);
+            return new(::operator new(bytes)) ManagedNuclBuffer(nullptr);
         }
 
-        ManagedNuclBuffer(size_t nucls, ST *buf) : _data(new ST[Sequence::DataSize(nucls)]) {
-            std::uninitialized_copy(buf, buf + Sequence::DataSize(nucls), data());
-        }
+        ManagedNuclBuffer(const ManagedNuclBuffer &) = delete;
+        ManagedNuclBuffer &operator=(const ManagedNuclBuffer &) = delete;
 
-    private:
-        ST *_data;
-    public:
-        const ST *data() const { return _data; }
+        const ST *data() const { return reinterpret_cast<const ST *>(this + 1); }
 
-        ST *data() { return _data; }
+        ST *data() { return reinterpret_cast<ST *>(this + 1); }
 
-        ~ManagedNuclBuffer() {
-            delete[] _data;
+        void Retain() const {
+            if (arena == nullptr)
+                ref_count.fetch_add(1, std::memory_order_relaxed);
+            else
+                ref_count.store(ref_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
         }
 
+        void Release() const {
+            if (arena == nullptr) {
+                if (ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    this->~ManagedNuclBuffer();
+                    ::operator delete(const_cast<ManagedNuclBuffer *>(this));
+                }
+            } else {
+                int cnt = ref_count.load(std::memory_order_relaxed) - 1;
+                ref_count.store(cnt, std::memory_order_relaxed);
+                if (cnt == 0)
+                    arena->live--;
+            }
+        }
     };
 
     size_t from_;
@@ -124,7 +221,63 @@ class Sequence {
     }
 
     Sequence(size_t size, int)
-            : from_(0), size_(size), rtl_(false), data_(new ManagedNuclBuffer(size_)) {}
+            : from_(0), size_(size), rtl_(false), data_(ManagedNuclBuffer::create(size_)) {}
+
+    //Reverses the order of 2-bit nucleotides in a word.
+    static ST reverseNucls(ST word) {
+        word = __builtin_bswap64(word);
+        word = ((word >> 4u) & 0x0F0F0F0F0F0F0F0Full) | ((word & 0x0F0F0F0F0F0F0F0Full) << 4u);
+        return ((word >> 2u) & 0x3333333333333333ull) | ((word & 0x3333333333333333ull) << 2u);
+    }
+
+    //Up to STN buffer nucleotides starting at absolute position i. Words after last_word are never read.
+    ST rawWord(size_t i, size_t last_word) const {
+        const ST *bytes = data_->data();
+        size_t w = i >> STNBits;
+        size_t off = (i & (STN - 1u)) << 1u;
+        ST res = bytes[w] >> off;
+        if (off != 0 && w + 1 <= last_word)
+            res |= bytes[w + 1] << (STBits - off);
+        return res;
+    }
+
+    //Nucleotides pos, pos + 1, ... of this sequence packed with pos in the lowest two bits. Bits after the end of the
+    //sequence are undefined and must be masked by the caller. pos must be smaller than size().
+    ST packedWord(size_t pos) const {
+        size_t last_word = (from_ + size_ - 1) >> STNBits;
+        if (!rtl_)
+            return rawWord(from_ + pos, last_word);
+        size_t j = from_ + size_ - 1 - pos;
+        size_t a = j >= STN - 1 ? j - (STN - 1) : 0;
+        return ~reverseNucls(rawWord(a, last_word)) >> ((STN - 1 - (j - a)) << 1u);
+    }
+
+    //ORs nucleotides of seq into zero-initialized packed buffer out starting from nucleotide pos.
+    static void writePacked(ST *out, size_t pos, const Sequence &seq) {
+        for (size_t i = 0; i < seq.size_; i += STN) {
+            size_t cnt = std::min(size_t(STN), seq.size_ - i);
+            ST word = seq.packedWord(i);
+            if (cnt < STN)
+                word &= (ST(1) << (cnt << 1u)) - 1u;
+            size_t p = pos + i;
+            size_t off = (p & (STN - 1u)) << 1u;
+            out[p >> STNBits] |= word << off;
+            if (off != 0 && (cnt << 1u) > STBits - off)
+                out[(p >> STNBits) + 1] |= word >> (STBits - off);
+        }
+    }
+
+    //Length of the longest common prefix of a[apos, apos + len) and b[bpos, bpos + len) compared a word at a time.
+    static size_t commonPrefix(const Sequence &a, size_t apos, const Sequence &b, size_t bpos, size_t len) {
+        for (size_t i = 0; i < len; i += STN) {
+            ST diff = a.packedWord(apos + i) ^ b.packedWord(bpos + i);
+            if (len - i < STN)
+                diff &= (ST(1) << ((len - i) << 1u)) - 1u;
+            if (diff != 0)
+                return i + (__builtin_ctzll(diff) >> 1u);
+        }
+        return len;
+    }
 
     //Low level constructor. Handle with care.
     Sequence(const Sequence &seq, size_t from, size_t size, bool rtl)
@@ -230,23 +383,15 @@ public:
         if (data_ == that.data_ && from_ == that.from_ && rtl_ == that.rtl_)
             return true;
 
-        for (size_t i = 0; i < size_; ++i) {
-            if (this->operator[](i) != that[i]) {
-                return false;
-            }
-        }
-        return true;
+        return commonPrefix(*this, 0, that, 0, size_) == size_;
     }
 
     bool operator<(const Sequence &other) const {
-        for (size_t i = 0; i < size_; ++i) {
-            if (i == other.size())
-                return true;
-            else if (this->operator[](i) != other[i]) {
-                return this->operator[](i) < other[i];
-            }
-        }
-        return false;
+        size_t len = std::min(size_, other.size_);
+        size_t pos = commonPrefix(*this, 0, other, 0, len);
+        if (pos < len)
+            return this->operator[](pos) < other[pos];
+        return size_ > other.size_;
     }
 
     bool operator<=(const Sequence &other) const {
@@ -318,6 +463,11 @@ public:
         return Subseq(0, ms) == other.Subseq(0, ms);
     }
 
+    bool contains(const Sequence &s, size_t offset = 0) const {
+        VERIFY(offset + s.size() <= size());
+        return commonPrefix(*this, offset, s, 0, s.size()) == s.size();
+    }
+
     template<class Seq>
     bool contains(const Seq &s, size_t offset = 0) const {
         VERIFY_DEV(offset + s.size() <= size());
@@ -333,13 +483,67 @@ public:
         return Sequence(*this, from_, size_, !rtl_);
     }
 
-    size_t commonPrefix(const Sequence & other) const {
-        size_t res = 0;
-        while(res < size() && res < other.size() && this->operator[](res) == other[res])
-            res += 1;
+    //Allocates a sequence of given size and lets writer fill its packed buffer in place. Buffer holds 32 nucleotides
+    //per 64-bit word with the first nucleotide in the lowest two bits.
+    template<class Writer>
+    static Sequence fromPacked(size_t size, Writer writer) {
+        Sequence res(size, 0);
+        writer(res.data_->data());
         return res;
     }
 
+    //Writes nucleotides in the layout expected by fromPacked. out must have (size() + 31) / 32 words.
+    void pack(ST *out) const {
+        size_t words = DataSize(size_);
+        if (words == 0)
+            return;
+        if (!rtl_ && (from_ & (STN - 1u)) == 0) {
+            std::copy(data_->data() + (from_ >> STNBits), data_->data() + (from_ >> STNBits) + words, out);
+        } else {
+            std::vector<unsigned char> buf(size_);
+            unpack(buf.data());
+            for (size_t i = 0; i < size_; i += STN) {
+                ST word = 0;
+                for (size_t j = std::min(size_, i + STN); j > i; j--)
+                    word = (word << 2u) | buf[j - 1];
+                out[i >> STNBits] = word;
+            }
+        }
+        if ((size_ & (STN - 1u)) != 0)
+            out[words - 1] &= (ST(1) << ((size_ & (STN - 1u)) << 1u)) - 1u;
+    }
+
+    //Writes all nucleotides (values 0-3) to out decoding a whole packed word at a time. out must have size() elements.
+    void unpack(unsigned char *out) const {
+        const ST *bytes = data_->data();
+        size_t i = from_;
+        const size_t end = from_ + size_;
+        unsigned char *cur = out;
+        while (i < end) {
+            ST word = bytes[i >> STNBits] >> ((i & (STN - 1u)) << 1u);
+            size_t cnt = std::min<size_t>(STN - (i & (STN - 1u)), end - i);
+            for (size_t j = 0; j < cnt; j++) {
+                *cur = word & 3u;
+                ++cur;
+                word >>= 2u;
+            }
+            i += cnt;
+        }
+        if (rtl_) {
+            std::reverse(out, out + size_);
+            for (size_t j = 0; j < size_; j++)
+                out[j] = complement(out[j]);
+        }
+    }
+
+    size_t commonPrefix(const Sequence & other) const {
+        return commonPrefix(*this, 0, other, 0, std::min(size(), other.size()));
+    }
+
+    size_t commonSuffix(const Sequence & other) const {
+        return (!*this).commonPrefix(!other);
+    }
+
     Sequence makeSequence() {
         return *this;
     }
@@ -377,9 +581,6 @@ Sequence Sequence::Suffix(size_t count) const {
 }
 
 
-/**
- * @todo optimize sequence copy
- */
 Sequence Sequence::operator+(const Sequence &s) const {
     if (data_ == s.data_ && rtl_ == s.rtl_ &&
             (
@@ -390,7 +591,12 @@ Sequence Sequence::operator+(const Sequence &s) const {
     {
         return Sequence(*this, std::min(from_, s.from_), size_ + s.size_, rtl_);
     } else {
-        return Sequence(str() + s.str());
+        Sequence res(size_ + s.size_, 0);
+        ST *out = res.data_->data();
+        std::fill(out, out + DataSize(res.size_), ST(0));
+        writePacked(out, 0, *this);
+        writePacked(out, size_, s);
+        return res;
     }
 }
 
@@ -420,6 +626,11 @@ std::ostream &operator<<(std::ostream &os, const Sequence &s) {
 class SequenceBuilder {
     std::vector<char> buf_;
 public:
+    SequenceBuilder &reserve(size_t size) {
+        buf_.reserve(size);
+        return *this;
+    }
+
     template<typename S>
     SequenceBuilder &append(const S &s) {
         for (size_t i = 0; i < s.size(); ++i) {
@@ -35,6 +35,9 @@
 #include <zlib.h>
 #include <string>
 #include <cstring>
+#include <thread>
+#include <vector>
+#include "common/bounded_queue.hpp"
 
 
 namespace gzstream {
@@ -210,4 +213,72 @@ public:
     }
 };
 
+// ----------------------------------------------------------------------------
+// Input stream that decompresses the file on a background thread. Decompressed
+// data is passed to the reading thread in large blocks through a bounded queue
+// so that parsing of one block overlaps with inflating of the next ones.
+// Putback is only guaranteed within a block.
+// ----------------------------------------------------------------------------
+
+class pipegzstreambuf : public std::streambuf {
+private:
+    static const size_t blockSize = 1 << 22;
+    static const size_t queueSize = 4;
+
+    BoundedQueue<std::vector<char>> blocks;
+    std::vector<char> current;
+    std::thread worker;
+
+    static void inflateAll(gzFile file, BoundedQueue<std::vector<char>> &blocks) {
+        while (true) {
+            std::vector<char> block(blockSize);
+            int num = gzread( file, block.data(), blockSize);
+            if (num <= 0) // ERROR or EOF
+                break;
+            block.resize(num);
+            if (!blocks.push(std::move(block)))
+                break;
+        }
+        gzclose( file);
+        blocks.close();
+    }
+public:
+    explicit pipegzstreambuf( const char* name) : blocks(queueSize) {
+        setg( nullptr, nullptr, nullptr);
+        gzFile file = gzopen( name, "rb");
+        if (file == 0) {
+            blocks.close();
+            return;
+        }
+        gzbuffer( file, 1 << 20);
+        worker = std::thread(inflateAll, file, std::ref(blocks));
+    }
+
+    pipegzstreambuf(const pipegzstreambuf &) = delete;
+
+    ~pipegzstreambuf() {
+        blocks.close();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    virtual int underflow() {
+        if ( gptr() && ( gptr() < egptr()))
+            return * reinterpret_cast<unsigned char *>( gptr());
+        if (!blocks.pop(current))
+            return EOF;
+        setg( current.data(), current.data(), current.data() + current.size());
+        return * reinterpret_cast<unsigned char *>( gptr());
+    }
+};
+
+class ipipegzstream : public std::istream {
+private:
+    pipegzstreambuf buf;
+public:
+    explicit ipipegzstream( const char* name) : std::istream(nullptr), buf(name) {
+        rdbuf( &buf);
+    }
+};
+
 }
\ No newline at end of file